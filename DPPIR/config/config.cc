@@ -53,6 +53,14 @@ void ReadIntoBuffer(std::array<unsigned char, SZ>* buff, const char** data,
 
 }  // namespace
 
+std::vector<index_t> ServerWeights(const PartyConfig& party) {
+  std::vector<index_t> weights;
+  for (const ServerConfig& server : party.servers) {
+    weights.push_back(server.weight);
+  }
+  return weights;
+}
+
 // Serialize to a string.
 std::string Serialize(const Config& config) {
   std::string data = "";
@@ -80,6 +88,16 @@ std::string Serialize(const Config& config) {
       data.push_back('\0');
     }
   }
+  // Optional protocol options.
+  data += Int2Bin(static_cast<int>(config.onion_scheme.format));
+  data += Int2Bin(config.onion_scheme.seeded);
+  data += Int2Bin(config.sample_noise);
+  data += Int2Bin(static_cast<int>(config.noise_mechanism));
+  for (const PartyConfig& party : config.parties) {
+    for (const ServerConfig& server : party.servers) {
+      data += Int2Bin(server.weight);
+    }
+  }
   return data;
 }
 
@@ -109,6 +127,33 @@ Config Deserialize(const char* str, size_t n) {
     }
     config.parties.push_back(party);
   }
+  // Optional protocol options: older config files end here.
+  if (n > 0) {
+    int format = Bin2Int(&str, &n);
+    assert(format >= static_cast<int>(OnionFormat::kSealed) &&
+           format <= static_cast<int>(OnionFormat::kHybridAesGcm));
+    config.onion_scheme.format = static_cast<OnionFormat>(format);
+  }
+  if (n > 0) {
+    config.onion_scheme.seeded = Bin2Int(&str, &n);
+  }
+  if (n > 0) {
+    config.sample_noise = Bin2Int(&str, &n);
+  }
+  if (n > 0) {
+    int mechanism = Bin2Int(&str, &n);
+    assert(mechanism >= static_cast<int>(NoiseMechanism::kLaplace) &&
+           mechanism <= static_cast<int>(NoiseMechanism::kGeometric));
+    config.noise_mechanism = static_cast<NoiseMechanism>(mechanism);
+  }
+  if (n > 0) {
+    for (PartyConfig& party : config.parties) {
+      for (ServerConfig& server : party.servers) {
+        server.weight = Bin2Int(&str, &n);
+        assert(server.weight > 0 && server.weight <= MAX_SERVER_WEIGHT);
+      }
+    }
+  }
   // Should have consumed all buffer.
   assert(n == 0);
   return config;
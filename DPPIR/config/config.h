@@ -14,6 +14,9 @@ struct ServerConfig {
   int port;
   int parallel_port;
   std::string ip;
+  // Relative capacity: the share of noise and of the shuffled batch this
+  // server gets is proportional to its weight (optional, see Config).
+  int weight = 1;
 };
 
 struct PartyConfig {
@@ -35,8 +38,16 @@ struct Config {
   party_id_t party_count;
   server_id_t server_count;  // # server per party (parallelism).
   std::vector<PartyConfig> parties;
+  // Optional protocol options (absent from older config files).
+  OnionScheme onion_scheme;
+  bool sample_noise = false;  // Sample real noise instead of its mean.
+  NoiseMechanism noise_mechanism = NoiseMechanism::kLaplace;
+  // Server weights (ServerConfig::weight) are stored after these options.
 };
 
+// Weights of the servers of party (see ServerConfig::weight).
+std::vector<index_t> ServerWeights(const PartyConfig& party);
+
 // Serialize/Deserialize.
 std::string Serialize(const Config& config);
 Config Deserialize(const char* str, size_t n);
@@ -17,6 +17,10 @@ void EnsureEqual(const Config& c1, const Config& c2) {
   assert(c1.delta == c2.delta);
   assert(c1.party_count == c2.party_count);
   assert(c1.server_count == c2.server_count);
+  assert(c1.onion_scheme.format == c2.onion_scheme.format);
+  assert(c1.onion_scheme.seeded == c2.onion_scheme.seeded);
+  assert(c1.sample_noise == c2.sample_noise);
+  assert(c1.noise_mechanism == c2.noise_mechanism);
   assert(c1.parties.size() == c1.party_count);
   assert(c2.parties.size() == c2.party_count);
   for (size_t i = 0; i < c1.parties.size(); i++) {
@@ -32,6 +36,7 @@ void EnsureEqual(const Config& c1, const Config& c2) {
       assert(s1.port == s2.port);
       assert(s1.parallel_port == s2.parallel_port);
       assert(s1.ip == s2.ip);
+      assert(s1.weight == s2.weight);
     }
     for (size_t j = 0; j < p1.onion_pkey.size(); j++) {
       assert(p1.onion_pkey[j] == p2.onion_pkey[j]);
@@ -53,6 +58,10 @@ Config DummyConfig() {
   // Parties config.
   config.party_count = 3;
   config.server_count = 2;
+  config.onion_scheme.format = OnionFormat::kHybridXChaCha20;
+  config.onion_scheme.seeded = true;
+  config.sample_noise = true;
+  config.noise_mechanism = NoiseMechanism::kGeometric;
   config.parties = std::vector<PartyConfig>(config.party_count);
   for (size_t i = 0; i < config.party_count; i++) {
     // One party at a time.
@@ -66,6 +75,7 @@ Config DummyConfig() {
           4000 + i * config.server_count + j;
       config.parties[i].servers[j].ip =
           std::string("260.16.") + std::to_string(i) + "." + std::to_string(j);
+      config.parties[i].servers[j].weight = j + 1;
     }
     // Generate onion encryption keys.
     onion::GenerateKeyPair(&config.parties[i].onion_pkey,
@@ -94,6 +104,32 @@ void TestFile() {
   EnsureEqual(config, deserialized);
 }
 
+// Test that config files without the optional options still load.
+void TestBackwardCompatible() {
+  Config config = DummyConfig();
+  std::string ser = Serialize(config);
+  // Strip options and server weights.
+  size_t weights = config.party_count * config.server_count;
+  ser.resize(ser.size() - (4 + weights) * sizeof(int));
+  Config deserialized = Deserialize(ser.c_str(), ser.size());
+  assert(deserialized.onion_scheme.format == OnionFormat::kSealed);
+  assert(!deserialized.onion_scheme.seeded);
+  assert(!deserialized.sample_noise);
+  assert(deserialized.noise_mechanism == NoiseMechanism::kLaplace);
+  // Everything else must be equal.
+  deserialized.onion_scheme = config.onion_scheme;
+  deserialized.sample_noise = config.sample_noise;
+  deserialized.noise_mechanism = config.noise_mechanism;
+  for (size_t i = 0; i < config.parties.size(); i++) {
+    for (size_t j = 0; j < config.server_count; j++) {
+      ServerConfig& server = deserialized.parties.at(i).servers.at(j);
+      assert(server.weight == 1);
+      server.weight = config.parties.at(i).servers.at(j).weight;
+    }
+  }
+  EnsureEqual(config, deserialized);
+}
+
 }  // namespace config
 }  // namespace DPPIR
 
@@ -108,6 +144,10 @@ int main() {
   DPPIR::config::TestFile();
   std::cout << "Test pass!" << std::endl;
 
+  std::cout << "Testing backward compatibility..." << std::endl;
+  DPPIR::config::TestBackwardCompatible();
+  std::cout << "Test pass!" << std::endl;
+
   std::cout << "All tests passed!" << std::endl;
   return 0;
 }
@@ -1,6 +1,9 @@
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "DPPIR/config/config.h"
 #include "DPPIR/onion/onion.h"
@@ -99,12 +102,107 @@ Config FromArgs(int argc, char** argv) {
   return config;
 }
 
+// Optional protocol options, given as --name=value.
+bool ApplyOption(Config* config, const std::string& option) {
+  size_t eq = option.find('=');
+  if (eq == std::string::npos) {
+    return false;
+  }
+  std::string name = option.substr(2, eq - 2);
+  std::string value = option.substr(eq + 1);
+  if (name == "onion_format") {
+    if (value == "sealed") {
+      config->onion_scheme.format = OnionFormat::kSealed;
+    } else if (value == "xchacha20") {
+      config->onion_scheme.format = OnionFormat::kHybridXChaCha20;
+    } else if (value == "aesgcm") {
+      config->onion_scheme.format = OnionFormat::kHybridAesGcm;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (name == "seeded_preshares") {
+    if (value != "true" && value != "false") {
+      return false;
+    }
+    config->onion_scheme.seeded = value == "true";
+    return true;
+  }
+  if (name == "sample_noise") {
+    if (value != "true" && value != "false") {
+      return false;
+    }
+    config->sample_noise = value == "true";
+    return true;
+  }
+  if (name == "noise_mechanism") {
+    if (value == "laplace") {
+      config->noise_mechanism = NoiseMechanism::kLaplace;
+    } else if (value == "geometric") {
+      config->noise_mechanism = NoiseMechanism::kGeometric;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (name == "server_weights") {
+    // Either one weight per server (the same for all parties), or one per
+    // server of every party.
+    std::vector<int> weights;
+    size_t start = 0;
+    while (start <= value.size()) {
+      size_t end = value.find(',', start);
+      if (end == std::string::npos) {
+        end = value.size();
+      }
+      std::string token = value.substr(start, end - start);
+      char* rest;
+      errno = 0;
+      long weight = std::strtol(token.c_str(), &rest, 10);
+      if (token.empty() || *rest != '\0' || errno != 0 || weight <= 0 ||
+          weight > MAX_SERVER_WEIGHT) {
+        return false;
+      }
+      weights.push_back(weight);
+      start = end + 1;
+    }
+    size_t servers = config->server_count;
+    if (weights.size() != servers &&
+        weights.size() != config->party_count * servers) {
+      return false;
+    }
+    for (size_t i = 0; i < config->party_count; i++) {
+      for (size_t j = 0; j < servers; j++) {
+        size_t idx = weights.size() == servers ? j : i * servers + j;
+        config->parties.at(i).servers.at(j).weight = weights.at(idx);
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
 }  // namespace config
 }  // namespace DPPIR
 
 int main(int argc, char** argv) {
   assert(sodium_init() >= 0);
 
+  // Separate optional --name=value options from positional arguments.
+  std::vector<char*> args;
+  std::vector<std::string> options;
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i > 0 && arg.rfind("--", 0) == 0) {
+      options.push_back(arg);
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  argc = args.size();
+  argv = args.data();
+
   // Build config struct.
   DPPIR::config::Config config;
   if (argc < 2) {
@@ -117,6 +215,14 @@ int main(int argc, char** argv) {
     config = DPPIR::config::FromArgs(argc - 1, argv + 1);
   }
 
+  // Apply options.
+  for (const std::string& option : options) {
+    if (!DPPIR::config::ApplyOption(&config, option)) {
+      std::cout << "Unrecognizable option " << option << std::endl;
+      return 1;
+    }
+  }
+
   // Write to file.
   std::string file = argv[1];
   DPPIR::config::WriteToFile(config, file);
@@ -3,8 +3,11 @@
 #include <string>
 
 #include "DPPIR/config/config.h"
+#include "DPPIR/onion/onion.h"
+#include "DPPIR/parallel/parallel.h"
 #include "DPPIR/protocol/backend/backend.h"
 #include "DPPIR/protocol/client/client.h"
+#include "DPPIR/protocol/noise_store/noise_store.h"
 #include "DPPIR/protocol/parallel_party/parallel_party.h"
 #include "DPPIR/protocol/party/party.h"
 #include "DPPIR/types/database.h"
@@ -17,12 +20,29 @@
 
 // Command line flags.
 ABSL_FLAG(std::string, role, "", "The role: client or party");
-ABSL_FLAG(std::string, stage, "", "One of: offline, online, or all (required)");
+ABSL_FLAG(std::string, stage, "",
+          "One of: offline, online, all, or precompute (required)");
 ABSL_FLAG(std::string, config, "",
           "The config file name (must be under <DPPIR DIR>/config) (required)");
 ABSL_FLAG(int, server_id, -1, "The server id for parallelism (required)");
 ABSL_FLAG(int, party_id, -1, "The party id (required if role is party)");
 ABSL_FLAG(int64_t, queries, -1, "# of queries (required if role is client)");
+ABSL_FLAG(int, threads, 0, "# of worker threads (0 means all cores)");
+ABSL_FLAG(bool, pipeline, false,
+          "Receive, decrypt and create noise ciphers concurrently (parties)");
+ABSL_FLAG(bool, blocked_shuffle, false,
+          "Shuffle in cache sized blocks, uses more memory (single server "
+          "parties)");
+ABSL_FLAG(bool, implicit_shuffle, false,
+          "Compute local shuffles on the fly to save memory (parties)");
+ABSL_FLAG(bool, zerocopy, false,
+          "Send query and response batches with MSG_ZEROCOPY (parties and "
+          "backend)");
+ABSL_FLAG(std::string, noise_store, "",
+          "Directory of precomputed noise, used by the offline stage "
+          "(parties)");
+ABSL_FLAG(int, noise_slots, 1,
+          "# of batches to precompute noise for with --stage=precompute");
 
 int main(int argc, char** argv) {
   assert(sodium_init() >= 0);
@@ -36,6 +56,13 @@ int main(int argc, char** argv) {
   int server_id = absl::GetFlag(FLAGS_server_id);
   int party_id = absl::GetFlag(FLAGS_party_id);
   int64_t queries = absl::GetFlag(FLAGS_queries);
+  int threads = absl::GetFlag(FLAGS_threads);
+  bool pipeline = absl::GetFlag(FLAGS_pipeline);
+  bool blocked_shuffle = absl::GetFlag(FLAGS_blocked_shuffle);
+  bool implicit_shuffle = absl::GetFlag(FLAGS_implicit_shuffle);
+  bool zerocopy = absl::GetFlag(FLAGS_zerocopy);
+  std::string noise_store = absl::GetFlag(FLAGS_noise_store);
+  int noise_slots = absl::GetFlag(FLAGS_noise_slots);
 
   // Validate flags.
   if (configfile == "") {
@@ -43,10 +70,12 @@ int main(int argc, char** argv) {
     return 1;
   }
   if (stage == "") {
-    std::cout << "--stage=[online|offline|all] is required" << std::endl;
+    std::cout << "--stage=[online|offline|all|precompute] is required"
+              << std::endl;
     return 1;
   }
-  if (stage != "online" && stage != "offline" && stage != "all") {
+  if (stage != "online" && stage != "offline" && stage != "all" &&
+      stage != "precompute") {
     std::cout << "Unrecognizable stage" << std::endl;
     return 1;
   }
@@ -66,13 +95,33 @@ int main(int argc, char** argv) {
     std::cout << "--queries is required for clients" << std::endl;
     return 1;
   }
+  if (stage == "precompute" && (role != "party" || noise_store == "")) {
+    std::cout << "--stage=precompute requires --role=party and --noise_store"
+              << std::endl;
+    return 1;
+  }
+  if (noise_slots < 0) {
+    std::cout << "--noise_slots must be non-negative" << std::endl;
+    return 1;
+  }
   if (server_id < 0) {
     std::cout << "--server_id is required" << std::endl;
     return 1;
   }
+  if (threads < 0) {
+    std::cout << "--threads must be non-negative" << std::endl;
+    return 1;
+  }
+  if (threads > 0) {
+    DPPIR::parallel::SetThreadCount(threads);
+  }
 
   // Read config.
   DPPIR::config::Config config = DPPIR::config::ReadFile(configfile);
+  if (!DPPIR::onion::IsAvailable(config.onion_scheme.format)) {
+    std::cout << "Onion format is not supported on this machine" << std::endl;
+    return 1;
+  }
 
   // Initialize database.
   DPPIR::Database db(config.db_size);
@@ -87,6 +136,23 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  // Fill the noise store and exit.
+  if (stage == "precompute") {
+    if (party_id == config.party_count - 1) {
+      std::cout << "The backend party does not add noise" << std::endl;
+      return 1;
+    }
+    DPPIR::protocol::NoiseStore store(noise_store, config, party_id,
+                                      server_id);
+    if (!DPPIR::protocol::PrecomputeNoise(config, party_id, server_id, &store,
+                                          noise_slots)) {
+      std::cout << "Cannot store precomputed noise" << std::endl;
+      return 1;
+    }
+    std::cout << "Done!" << std::endl;
+    return 0;
+  }
+
   // Stages to run.
   bool offline = stage == "offline" || stage == "all";
   bool online = stage == "online" || stage == "all";
@@ -100,15 +166,23 @@ int main(int argc, char** argv) {
       if (config.server_count == 1) {
         DPPIR::protocol::Party party(party_id, server_id, std::move(config),
                                      std::move(db));
-        party.Start(offline, online);
+        party.SetNoiseStore(noise_store);
+        party.SetBlockedShuffle(blocked_shuffle);
+        party.SetImplicitShuffle(implicit_shuffle);
+        party.SetZeroCopy(zerocopy);
+        party.Start(offline, online, pipeline);
       } else {
         DPPIR::protocol::ParallelParty party(party_id, server_id,
                                              std::move(config), std::move(db));
-        party.Start(offline, online);
+        party.SetNoiseStore(noise_store);
+        party.SetImplicitShuffle(implicit_shuffle);
+        party.SetZeroCopy(zerocopy);
+        party.Start(offline, online, pipeline);
       }
     } else {
       DPPIR::protocol::BackendParty backend(server_id, std::move(config),
                                             std::move(db));
+      backend.SetZeroCopy(zerocopy);
       backend.Start(offline, online);
     }
   }
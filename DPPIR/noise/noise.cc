@@ -2,9 +2,9 @@
 
 #include <cassert>
 #include <cmath>
-#include <cstdlib>
 #include <iostream>
-#include <random>
+
+#include "DPPIR/random/random.h"
 
 namespace DPPIR {
 namespace noise {
@@ -12,48 +12,58 @@ namespace noise {
 // Laplace helpers.
 namespace {
 
-double Laplace(double mean, double span) {
-  int sign = (RandUniform() < 0.5) ? -1 : 1;
-  double u = RandUniform();
-  return mean - sign * span * std::log(1 - 2 * std::abs(u - 0.5));
-}
-
 // Returns the x such that Prob[lap(mean, span) <= x] = prob.
 double InvCDF(double mean, double span, double prob) {
   int sign = (prob > 0.5) ? -1 : 1;
   return mean - sign * span * std::log(1 - 2 * std::abs(prob - 0.5));
 }
 
+// Prob[lap(0, span) < x].
+double CDF(double span, double x) {
+  if (x < 0) {
+    return 0.5 * std::exp(x / span);
+  }
+  return 1 - 0.5 * std::exp(-x / span);
+}
+
 }  // namespace
 
 // Uniform in [0, 1)
-double RandUniform() { return std::rand() / static_cast<double>(RAND_MAX); }
+double RandUniform() {
+  return random::ThreadSampler().Next32() / 4294967296.0;
+}
 
 // Find the range that the server is responsible for adding noise for.
 std::pair<key_t, key_t> FindRange(server_id_t server_id,
-                                  server_id_t servers_count, index_t db_size) {
+                                  server_id_t servers_count, index_t db_size,
+                                  const std::vector<index_t>& weights) {
   assert(db_size >= servers_count);
-  index_t range_size = std::ceil(1.0 * db_size / servers_count);
-  key_t range_start = server_id * range_size;
-  key_t range_end = range_start + range_size;
-  if (server_id == servers_count - 1) {
-    range_end = db_size;
-  }
-  return std::make_pair(range_start, range_end);
+  return WeightedRange(server_id, servers_count, weights, db_size);
 }
 
 // NoiseDistribution.
-NoiseDistribution::NoiseDistribution(double epsilon, double delta) {
+NoiseDistribution::NoiseDistribution(double epsilon, double delta,
+                                     bool sample, NoiseMechanism mechanism)
+    : sample_(sample) {
   if (epsilon == 0 || delta == 0) {
     this->debug_ = true;
     this->span_ = 0;
     this->cutoff_ = 0;
     std::cout << "No noise!" << std::endl;
-  } else {
+  } else if (mechanism == NoiseMechanism::kLaplace) {
     this->debug_ = false;
     this->span_ = 2 / epsilon;
     this->cutoff_ = InvCDF(0, this->span_, delta / 2);
     std::cout << "Noise cutoff: " << this->cutoff_ << std::endl;
+  } else {
+    this->debug_ = false;
+    this->span_ = 2 / epsilon;
+    // Prob[G <= -(shift + 1)] = alpha^(shift + 1) / (1 + alpha).
+    double alpha = std::exp(-1 / this->span_);
+    double shift = std::ceil(std::log(delta / 2 * (1 + alpha)) /
+                             std::log(alpha)) - 1;
+    this->cutoff_ = std::fmax(0, shift);
+    std::cout << "Noise shift: " << this->cutoff_ << std::endl;
   }
   // Noise domain must fit inside sample_t.
   index_t max = std::floor(2 * this->cutoff_);
@@ -61,13 +71,116 @@ NoiseDistribution::NoiseDistribution(double epsilon, double delta) {
     std::cout << "sample_t too small to fit noise, max = " << max << std::endl;
     assert(false);
   }
+  this->max_ = max;
+  this->mean_ = this->cutoff_;
+
+  // Compute the distribution.
+  std::vector<double> pmf = {1};
+  if (!this->debug_) {
+    pmf = mechanism == NoiseMechanism::kLaplace ? this->LaplacePMF()
+                                                 : this->GeometricPMF();
+  }
+  this->expected_ = 0;
+  for (size_t k = 0; k < pmf.size(); k++) {
+    this->expected_ += k * pmf[k];
+  }
+  if (this->sample_) {
+    std::cout << "Expected noise per key: " << this->expected_ << std::endl;
+    this->BuildAliasTable(pmf);
+  }
 }
 
-sample_t NoiseDistribution::SampleReal() const {
-  // Smaple noise from regular laplace, then clamp and floor.
-  double u = Laplace(0, this->span_);
-  u = std::fmax(0, this->cutoff_ + std::fmin(this->cutoff_, u));
-  return std::floor(u);
+std::vector<double> NoiseDistribution::LaplacePMF() const {
+  // Prob[sample = k] = Prob[k <= cutoff + lap < k + 1], where the clamped
+  // tails are folded into 0 and max.
+  std::vector<double> pmf(this->max_ + 1);
+  for (size_t k = 0; k <= this->max_; k++) {
+    double lower = k == 0 ? 0 : CDF(this->span_, k - this->cutoff_);
+    double upper =
+        k == this->max_ ? 1 : CDF(this->span_, k + 1 - this->cutoff_);
+    pmf[k] = upper - lower;
+  }
+  return pmf;
+}
+
+std::vector<double> NoiseDistribution::GeometricPMF() const {
+  // Prob[G = d] = (1 - alpha) / (1 + alpha) * alpha^|d|, and the truncated
+  // tails Prob[G <= -shift] = Prob[G >= shift] = alpha^shift / (1 + alpha)
+  // are folded into 0 and max.
+  double alpha = std::exp(-1 / this->span_);
+  std::vector<double> pmf(this->max_ + 1);
+  for (size_t k = 0; k <= this->max_; k++) {
+    double d = std::abs(static_cast<double>(k) - this->cutoff_);
+    if (k == 0 || k == this->max_) {
+      pmf[k] = std::pow(alpha, d) / (1 + alpha);
+    } else {
+      pmf[k] = (1 - alpha) / (1 + alpha) * std::pow(alpha, d);
+    }
+  }
+  if (this->max_ == 0) {
+    pmf[0] = 1;
+  }
+  return pmf;
+}
+
+void NoiseDistribution::BuildAliasTable(const std::vector<double>& pmf) {
+  size_t n = pmf.size();
+  // Probability of every value in the support, scaled by n.
+  std::vector<double> scaled(n);
+  for (size_t k = 0; k < n; k++) {
+    scaled[k] = pmf[k] * n;
+  }
+
+  // Pair every value with less than average probability with one with more.
+  this->thresholds_.resize(n);
+  this->aliases_.resize(n);
+  std::vector<sample_t> small;
+  std::vector<sample_t> large;
+  for (size_t k = 0; k < n; k++) {
+    this->aliases_[k] = k;
+    (scaled[k] < 1 ? small : large).push_back(k);
+  }
+  while (!small.empty() && !large.empty()) {
+    sample_t s = small.back();
+    sample_t l = large.back();
+    small.pop_back();
+    this->thresholds_[s] = std::llround(scaled[s] * 4294967296.0);
+    this->aliases_[s] = l;
+    scaled[l] = (scaled[l] + scaled[s]) - 1;
+    if (scaled[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // Left overs are 1 (up to rounding errors).
+  for (sample_t k : small) {
+    this->thresholds_[k] = 4294967296ull;
+  }
+  for (sample_t k : large) {
+    this->thresholds_[k] = 4294967296ull;
+  }
+}
+
+sample_t NoiseDistribution::Sample() const {
+  sample_t sample;
+  this->SampleBatch(&sample, 1);
+  return sample;
+}
+
+void NoiseDistribution::SampleBatch(sample_t* out, index_t count) const {
+  if (!this->sample_ || this->debug_) {
+    for (index_t i = 0; i < count; i++) {
+      out[i] = this->mean_;
+    }
+    return;
+  }
+  random::Sampler& sampler = random::ThreadSampler();
+  uint32_t n = this->thresholds_.size();
+  for (index_t i = 0; i < count; i++) {
+    uint32_t k = sampler.Uniform(n);
+    bool keep = sampler.Next32() < this->thresholds_[k];
+    out[i] = keep ? k : this->aliases_[k];
+  }
 }
 
 }  // namespace noise
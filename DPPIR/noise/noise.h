@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <utility>
+#include <vector>
 
 #include "DPPIR/types/types.h"
 
@@ -12,42 +13,69 @@
 namespace DPPIR {
 namespace noise {
 
+// Uniform in [0, 1), from the calling thread's CSPRNG.
 double RandUniform();
 
-// Define DPPIR_SAMPLE to use real noise.
-// For our experiments, we leave this undefined to add the average/expected
-// amount of noise to avoid having to average out over many runs for small
-// databases.
-// #define DPPIR_SAMPLE
-
+// Distribution of the number of noise queries for every DB key.
+// Laplace: floor(clamp(cutoff + Lap(2 / epsilon), 0, 2 * cutoff)), where the
+// clamped mass below 0 is delta / 2.
+// Geometric: shift + G, with G two-sided geometric with alpha =
+// exp(-epsilon / 2), truncated to [0, 2 * shift]. shift is the smallest
+// integer such that the truncated mass below 0 is at most delta / 2. This is
+// the discrete analogue of Laplace: it is defined directly on counts, so its
+// privacy does not rely on flooring a continuous sample.
 class NoiseDistribution {
  public:
-  NoiseDistribution(double epsilon, double delta);
+  // If sample is false, every sample is the mean/expected amount of noise.
+  // For our experiments, we use that to avoid having to average out over many
+  // runs for small databases. Real deployments must sample.
+  NoiseDistribution(double epsilon, double delta, bool sample,
+                    NoiseMechanism mechanism);
 
   // Either sample real noise or return the mean.
-#ifndef DPPIR_SAMPLE
-  inline sample_t Sample() const { return this->cutoff_; }
-#else
-  inline sample_t Sample() const { return this->SampleReal(); }
-#endif
+  sample_t Sample() const;
+  // Fills out[0, count) with samples (cheaper than calling Sample() count
+  // times). Can be called from several threads concurrently.
+  void SampleBatch(sample_t* out, index_t count) const;
+
+  // Expected number of noise queries per key (when sampling).
+  double ExpectedCount() const { return this->expected_; }
 
  private:
   // if true, we wont add any noise.
   bool debug_;
+  bool sample_;
   // Parameters for sampling our modified laplace noise.
   double span_;
-  double cutoff_;
-  // Real noise sampling.
-  sample_t SampleReal() const;
+  double cutoff_;  // Laplace cutoff, or geometric shift.
+  // Support of the noise is [0, max_].
+  sample_t max_;
+  // Returned when not sampling.
+  sample_t mean_;
+  double expected_;
+  // Real noise sampling: an alias table over the support (Vose's method).
+  // Entry k is kept with probability thresholds_[k] / 2^32, and replaced by
+  // aliases_[k] otherwise.
+  std::vector<uint64_t> thresholds_;
+  std::vector<sample_t> aliases_;
+  // Prob[sample = k] for every k in the support.
+  std::vector<double> LaplacePMF() const;
+  std::vector<double> GeometricPMF() const;
+  void BuildAliasTable(const std::vector<double>& pmf);
 
   // Make test a friend to access span_ and cutoff_.
 #ifdef DPPIR_NOISE_TEST
   friend bool TestLaplace();
+  friend bool TestDistribution();
+  friend bool TestGeometric();
 #endif
 };
 
+// The keys this server adds noise for: the domain is split proportionally to
+// the servers weights (see WeightedRange()).
 std::pair<key_t, key_t> FindRange(server_id_t server_id,
-                                  server_id_t servers_count, index_t db_size);
+                                  server_id_t servers_count, index_t db_size,
+                                  const std::vector<index_t>& weights);
 
 }  // namespace noise
 }  // namespace DPPIR
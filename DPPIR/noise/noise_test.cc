@@ -1,11 +1,11 @@
 #define DPPIR_NOISE_TEST
-#define DPPIR_SAMPLE
 
 #include "DPPIR/noise/noise.h"
 
 #include <cmath>
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 
 namespace DPPIR {
 namespace noise {
@@ -60,7 +60,8 @@ bool TestLaplace() {
                 << std::endl;
 
       // Create distribution instance.
-      DPPIR::noise::NoiseDistribution distribution(epsilon, delta);
+      DPPIR::noise::NoiseDistribution distribution(epsilon, delta, true,
+                                                   NoiseMechanism::kLaplace);
 
       // Check parameters.
       double span = SPAN[i * 2 + j];
@@ -101,6 +102,133 @@ bool TestLaplace() {
   return true;
 }
 
+// The frequency of every sample must match its probability under our
+// clamped and floored laplace.
+bool TestDistribution() {
+  NoiseDistribution distribution(1, 0.000001, true, NoiseMechanism::kLaplace);
+  double span = distribution.span_;
+  double cutoff = distribution.cutoff_;
+  size_t n = static_cast<size_t>(std::floor(2 * cutoff)) + 1;
+
+  std::vector<sample_t> samples(STATISTICAL_SIGNIFICANCE);
+  distribution.SampleBatch(samples.data(), samples.size());
+  std::vector<size_t> counts(n, 0);
+  for (sample_t sample : samples) {
+    if (sample >= n) {
+      std::cout << "Sample out of bounds!" << std::endl;
+      return false;
+    }
+    counts[sample]++;
+  }
+
+  auto cdf = [&](double x) {
+    x -= cutoff;
+    return x < 0 ? 0.5 * std::exp(x / span) : 1 - 0.5 * std::exp(-x / span);
+  };
+  for (size_t k = 0; k < n; k++) {
+    double lower = k == 0 ? 0 : cdf(k);
+    double upper = k == n - 1 ? 1 : cdf(k + 1);
+    double expected = (upper - lower) * STATISTICAL_SIGNIFICANCE;
+    // Within 5 standard deviations.
+    if (std::abs(counts[k] - expected) > 5 * std::sqrt(expected) + 1) {
+      std::cout << "Value " << k << " sampled " << counts[k] << " times"
+                << std::endl;
+      std::cout << "Expected " << expected << " times" << std::endl;
+      return false;
+    }
+  }
+
+  // Without sampling, we always get the mean.
+  NoiseDistribution mean(1, 0.000001, false, NoiseMechanism::kLaplace);
+  if (mean.Sample() != static_cast<sample_t>(cutoff)) {
+    std::cout << "Expected mean noise " << cutoff << std::endl;
+    return false;
+  }
+  std::cout << "Test pass!" << std::endl;
+  return true;
+}
+
+// The truncated geometric must match its definition, and cost about as much
+// noise as laplace for the same parameters.
+bool TestGeometric() {
+  for (size_t i = 0; i < 2; i++) {
+    for (size_t j = 0; j < 2; j++) {
+      double epsilon = EPSILON[i] * 10;
+      double delta = DELTA[j];
+      std::cout << "Test geometric epsilon = " << epsilon
+                << ", delta = " << delta << std::endl;
+      NoiseDistribution geometric(epsilon, delta, true,
+                                  NoiseMechanism::kGeometric);
+      NoiseDistribution laplace(epsilon, delta, true,
+                                NoiseMechanism::kLaplace);
+
+      // shift is the smallest with truncated mass below 0 at most delta / 2.
+      double alpha = std::exp(-epsilon / 2);
+      double shift = geometric.cutoff_;
+      if (shift != std::floor(shift) ||
+          std::pow(alpha, shift + 1) / (1 + alpha) > delta / 2 ||
+          std::pow(alpha, shift) / (1 + alpha) <= delta / 2) {
+        std::cout << "Bad shift " << shift << std::endl;
+        return false;
+      }
+      if (std::abs(geometric.ExpectedCount() - laplace.ExpectedCount()) > 1) {
+        std::cout << "Geometric expects " << geometric.ExpectedCount()
+                  << " noise queries, laplace " << laplace.ExpectedCount()
+                  << std::endl;
+        return false;
+      }
+
+      // Frequencies must match the two sided geometric.
+      size_t n = 2 * shift + 1;
+      std::vector<sample_t> samples(STATISTICAL_SIGNIFICANCE);
+      geometric.SampleBatch(samples.data(), samples.size());
+      std::vector<size_t> counts(n, 0);
+      uint64_t total = 0;
+      for (sample_t sample : samples) {
+        if (sample >= n) {
+          std::cout << "Sample out of bounds!" << std::endl;
+          return false;
+        }
+        counts[sample]++;
+        total += sample;
+      }
+      for (size_t k = 0; k < n; k++) {
+        double d = std::abs(static_cast<double>(k) - shift);
+        double p = (1 - alpha) / (1 + alpha) * std::pow(alpha, d);
+        if (k == 0 || k == n - 1) {
+          p = std::pow(alpha, d) / (1 + alpha);
+        }
+        double expected = p * STATISTICAL_SIGNIFICANCE;
+        if (std::abs(counts[k] - expected) > 5 * std::sqrt(expected) + 1) {
+          std::cout << "Value " << k << " sampled " << counts[k] << " times"
+                    << std::endl;
+          std::cout << "Expected " << expected << " times" << std::endl;
+          return false;
+        }
+      }
+
+      // Symmetric around shift.
+      double avg = 1.0 * total / STATISTICAL_SIGNIFICANCE;
+      if (std::abs(geometric.ExpectedCount() - shift) > 0.000001 ||
+          std::abs(avg - shift) > 0.1) {
+        std::cout << "Expected samples to average " << shift << std::endl;
+        std::cout << "Instead found " << avg << std::endl;
+        return false;
+      }
+
+      // Without sampling, we always get the shift.
+      NoiseDistribution mean(epsilon, delta, false,
+                             NoiseMechanism::kGeometric);
+      if (mean.Sample() != shift) {
+        std::cout << "Expected mean noise " << shift << std::endl;
+        return false;
+      }
+      std::cout << "Test pass!" << std::endl;
+    }
+  }
+  return true;
+}
+
 }  // namespace noise
 }  // namespace DPPIR
 
@@ -115,6 +243,12 @@ int main(int argc, char *argv[]) {
   if (!DPPIR::noise::TestLaplace()) {
     return 1;
   }
+  if (!DPPIR::noise::TestDistribution()) {
+    return 1;
+  }
+  if (!DPPIR::noise::TestGeometric()) {
+    return 1;
+  }
 
   std::cout << "All done!" << std::endl;
   return 0;
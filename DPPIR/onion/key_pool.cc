@@ -0,0 +1,61 @@
+#include "DPPIR/onion/key_pool.h"
+
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+namespace DPPIR {
+namespace onion {
+
+void KeyPool::Start(size_t capacity, unsigned threads) {
+  this->Stop();
+  {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    if (this->size_ > 0) {
+      sodium_memzero(this->pairs_.get(),
+                     this->size_ * sizeof(EphemeralKeyPair));
+    }
+    this->pairs_ = std::make_unique<EphemeralKeyPair[]>(capacity);
+    this->capacity_ = capacity;
+    this->size_ = 0;
+  }
+  this->produced_ = 0;
+  this->stop_ = false;
+  for (unsigned i = 0; i < threads; i++) {
+    this->workers_.emplace_back(&KeyPool::Fill, this);
+  }
+}
+
+void KeyPool::Stop() {
+  this->stop_ = true;
+  for (std::thread& worker : this->workers_) {
+    worker.join();
+  }
+  this->workers_.clear();
+}
+
+bool KeyPool::Take(EphemeralKeyPair* pair) {
+  std::lock_guard<std::mutex> lock(this->mtx_);
+  if (this->size_ == 0) {
+    return false;
+  }
+  EphemeralKeyPair* slot = this->pairs_.get() + --this->size_;
+  *pair = *slot;
+  sodium_memzero(slot, sizeof(EphemeralKeyPair));
+  return true;
+}
+
+void KeyPool::Fill() {
+  // Claim a slot before generating, so that we never exceed capacity.
+  while (!this->stop_ && this->produced_++ < this->capacity_) {
+    EphemeralKeyPair pair;
+    crypto_box_keypair(pair.pkey.data(), pair.skey.data());
+    {
+      std::lock_guard<std::mutex> lock(this->mtx_);
+      this->pairs_[this->size_++] = pair;
+    }
+    sodium_memzero(&pair, sizeof(pair));
+  }
+}
+
+}  // namespace onion
+}  // namespace DPPIR
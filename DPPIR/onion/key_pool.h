@@ -0,0 +1,59 @@
+// Pool of precomputed ephemeral X25519 key pairs for onion encryption.
+#ifndef DPPIR_ONION_KEY_POOL_H_
+#define DPPIR_ONION_KEY_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+// NOLINTNEXTLINE
+#include <thread>
+#include <vector>
+
+#include "DPPIR/types/types.h"
+
+namespace DPPIR {
+namespace onion {
+
+struct EphemeralKeyPair {
+  pkey_t pkey;
+  skey_t skey;
+};
+
+// Background threads fill the pool (up to a fixed capacity) while the owner
+// is idle (e.g. waiting on the network), encryption then takes pairs out of it
+// instead of doing the fixed-base scalar multiplication inline.
+// Every pair is handed out at most once, and wiped from the pool when taken.
+class KeyPool {
+ public:
+  KeyPool() : capacity_(0), size_(0), produced_(0), stop_(false) {}
+  ~KeyPool() { this->Stop(); }
+
+  // Start threads generating up to capacity pairs.
+  // Pairs left over from a previous Start() are discarded.
+  void Start(size_t capacity, unsigned threads);
+
+  // Stop (and join) the generating threads. Generated pairs remain available.
+  void Stop();
+
+  // Takes a pair out of the pool, returns false if the pool is empty.
+  bool Take(EphemeralKeyPair* pair);
+
+ private:
+  void Fill();
+
+  std::unique_ptr<EphemeralKeyPair[]> pairs_;
+  size_t capacity_;
+  std::vector<std::thread> workers_;
+  // Pairs [0, size_) are available. Guarded by mtx_.
+  size_t size_;
+  std::mutex mtx_;
+  // Number of pairs claimed by the generating threads.
+  std::atomic<size_t> produced_;
+  std::atomic<bool> stop_;
+};
+
+}  // namespace onion
+}  // namespace DPPIR
+
+#endif  // DPPIR_ONION_KEY_POOL_H_
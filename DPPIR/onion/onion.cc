@@ -4,6 +4,7 @@
 #include <cassert>
 #include <cstring>
 
+#include "DPPIR/onion/key_pool.h"
 // NOLINTNEXTLINE
 #include "sodium.h"
 
@@ -13,15 +14,178 @@ namespace onion {
 #define CAST(buff) reinterpret_cast<unsigned char*>(buff)
 #define CCAST(buff) reinterpret_cast<const unsigned char*>(buff)
 
+// Every layer of a hybrid cipher is: epk || mac || payload.
+// This has the same size as a sealed box.
+#define EPK_BYTES crypto_box_PUBLICKEYBYTES
+#define MAC_BYTES 16
+static_assert(EPK_BYTES + MAC_BYTES == crypto_box_SEALBYTES);
+static_assert(crypto_aead_xchacha20poly1305_ietf_ABYTES == MAC_BYTES);
+static_assert(crypto_aead_aes256gcm_ABYTES == MAC_BYTES);
+
+namespace {
+
+// Every layer uses a fresh ephemeral key, and thus a fresh symmetric key, so
+// a constant nonce is safe.
+const unsigned char kNonce[crypto_aead_xchacha20poly1305_ietf_NPUBBYTES] = {};
+
+// Precomputed ephemeral key pairs.
+KeyPool key_pool;
+
+// Take a precomputed ephemeral key pair, or generate one if there is none.
+void EphemeralKeys(unsigned char* epk, unsigned char* esk) {
+  EphemeralKeyPair pair;
+  if (key_pool.Take(&pair)) {
+    memcpy(epk, pair.pkey.data(), EPK_BYTES);
+    memcpy(esk, pair.skey.data(), crypto_box_SECRETKEYBYTES);
+    sodium_memzero(&pair, sizeof(pair));
+  } else {
+    crypto_box_keypair(epk, esk);
+  }
+}
+
+// Same as crypto_box_seal(), but with the ephemeral key pair from
+// EphemeralKeys(): epk || box(m, nonce = H(epk || pk), pk, esk).
+// The output can be opened by crypto_box_seal_open().
+int Seal(unsigned char* c, const unsigned char* m, size_t len,
+         const unsigned char* pk) {
+  unsigned char esk[crypto_box_SECRETKEYBYTES];
+  unsigned char nonce[crypto_box_NONCEBYTES];
+  EphemeralKeys(c, esk);
+
+  crypto_generichash_state state;
+  crypto_generichash_init(&state, nullptr, 0, crypto_box_NONCEBYTES);
+  crypto_generichash_update(&state, c, EPK_BYTES);
+  crypto_generichash_update(&state, pk, crypto_box_PUBLICKEYBYTES);
+  crypto_generichash_final(&state, nonce, crypto_box_NONCEBYTES);
+
+  int status = crypto_box_easy(c + EPK_BYTES, m, len, nonce, pk, esk);
+  sodium_memzero(esk, sizeof(esk));
+  return status;
+}
+
+// Symmetric key of a layer: H(shared secret || epk || pk).
+void HybridKey(const unsigned char* shared, const unsigned char* epk,
+               const unsigned char* pk, unsigned char* key) {
+  crypto_generichash_state state;
+  crypto_generichash_init(&state, nullptr, 0, crypto_generichash_BYTES);
+  crypto_generichash_update(&state, shared, crypto_scalarmult_BYTES);
+  crypto_generichash_update(&state, epk, EPK_BYTES);
+  crypto_generichash_update(&state, pk, crypto_box_PUBLICKEYBYTES);
+  crypto_generichash_final(&state, key, crypto_generichash_BYTES);
+}
+
+// Symmetric encryption/decryption of a layer's payload (may be in place).
+int AeadEncrypt(OnionFormat format, unsigned char* c, unsigned char* mac,
+                const unsigned char* m, size_t len, const unsigned char* key) {
+  if (format == OnionFormat::kHybridAesGcm) {
+    return crypto_aead_aes256gcm_encrypt_detached(
+        c, mac, nullptr, m, len, nullptr, 0, nullptr, kNonce, key);
+  }
+  return crypto_aead_xchacha20poly1305_ietf_encrypt_detached(
+      c, mac, nullptr, m, len, nullptr, 0, nullptr, kNonce, key);
+}
+int AeadDecrypt(OnionFormat format, unsigned char* m, const unsigned char* c,
+                size_t len, const unsigned char* mac,
+                const unsigned char* key) {
+  if (format == OnionFormat::kHybridAesGcm) {
+    return crypto_aead_aes256gcm_decrypt_detached(m, nullptr, c, len, mac,
+                                                  nullptr, 0, kNonce, key);
+  }
+  return crypto_aead_xchacha20poly1305_ietf_decrypt_detached(
+      m, nullptr, c, len, mac, nullptr, 0, kNonce, key);
+}
+
+// Encrypt len bytes of plaintext at m into the layer starting at
+// c = m - crypto_box_SEALBYTES (in place).
+void SealLayer(unsigned char* c, size_t len, const pkey_t& pkey,
+               OnionFormat format) {
+  unsigned char* m = c + crypto_box_SEALBYTES;
+  if (format == OnionFormat::kSealed) {
+    auto status = Seal(c, m, len, pkey.data());
+    assert(status == 0);
+    return;
+  }
+
+  // Ephemeral key exchange.
+  unsigned char esk[crypto_box_SECRETKEYBYTES];
+  unsigned char shared[crypto_scalarmult_BYTES];
+  unsigned char key[crypto_generichash_BYTES];
+  EphemeralKeys(c, esk);
+  auto status = crypto_scalarmult(shared, esk, pkey.data());
+  assert(status == 0);
+  HybridKey(shared, c, pkey.data(), key);
+
+  // Encrypt payload.
+  status = AeadEncrypt(format, m, c + EPK_BYTES, m, len, key);
+  assert(status == 0);
+
+  sodium_memzero(esk, sizeof(esk));
+  sodium_memzero(shared, sizeof(shared));
+  sodium_memzero(key, sizeof(key));
+}
+
+// Decrypt a layer c of size len into m (which may be c + SEALBYTES).
+void OpenLayer(unsigned char* m, const unsigned char* c, size_t len,
+               const pkey_t& pkey, const skey_t& skey, OnionFormat format) {
+  if (format == OnionFormat::kSealed) {
+    auto status = crypto_box_seal_open(m, c, len, pkey.data(), skey.data());
+    assert(status == 0);
+    return;
+  }
+
+  // Recover the symmetric key.
+  unsigned char shared[crypto_scalarmult_BYTES];
+  unsigned char key[crypto_generichash_BYTES];
+  auto status = crypto_scalarmult(shared, skey.data(), c);
+  assert(status == 0);
+  HybridKey(shared, c, pkey.data(), key);
+
+  // Decrypt payload.
+  status = AeadDecrypt(format, m, c + crypto_box_SEALBYTES,
+                       len - crypto_box_SEALBYTES, c + EPK_BYTES, key);
+  assert(status == 0);
+
+  sodium_memzero(shared, sizeof(shared));
+  sodium_memzero(key, sizeof(key));
+}
+
+}  // namespace
+
 // Generate key pair.
 void GenerateKeyPair(pkey_t* pkey, skey_t* skey) {
   crypto_box_keypair(pkey->data(), skey->data());
 }
 
+// Precompute ephemeral key pairs in the background.
+void StartKeyPool(size_t capacity, unsigned threads) {
+  if (capacity > KEY_POOL_CAPACITY) {
+    capacity = KEY_POOL_CAPACITY;
+  }
+  key_pool.Start(capacity, threads);
+}
+void StopKeyPool() { key_pool.Stop(); }
+
+// Whether format can be used on this machine.
+bool IsAvailable(OnionFormat format) {
+  switch (format) {
+    case OnionFormat::kSealed:
+    case OnionFormat::kHybridXChaCha20:
+      return true;
+    case OnionFormat::kHybridAesGcm:
+      return crypto_aead_aes256gcm_is_available() == 1;
+  }
+  return false;
+}
+
+// Size of the OfflineSecret part of a single layer.
+size_t SecretSize(const OnionScheme& scheme) {
+  return scheme.seeded ? SEEDED_SECRET_SIZE : sizeof(OfflineSecret);
+}
+
 // Compute size of an onion cipher.
-size_t CipherSize(party_id_t party_count) {
+size_t CipherSize(party_id_t party_count, const OnionScheme& scheme) {
   size_t layers_count = party_count;
-  size_t single_size = sizeof(OfflineSecret) + crypto_box_SEALBYTES;
+  size_t single_size = SecretSize(scheme) + crypto_box_SEALBYTES;
   return single_size * layers_count;
 }
 
@@ -29,57 +193,103 @@ size_t CipherSize(party_id_t party_count) {
 std::unique_ptr<char[]> OnionEncrypt(const OfflineSecret* secrets,
                                      party_id_t first_party,
                                      party_id_t party_count,
-                                     const std::vector<pkey_t>& pkeys) {
+                                     const std::vector<pkey_t>& pkeys,
+                                     const OnionScheme& scheme) {
+  std::unique_ptr<char[]> output =
+      std::make_unique<char[]>(CipherSize(party_count - first_party, scheme));
+  OnionEncrypt(secrets, first_party, party_count, pkeys, output.get(), scheme);
+  return output;
+}
+
+// Onion encrypt into a caller-owned buffer.
+// Layers are sealed in place from the innermost one out: the cipher of a layer
+// ends exactly where its plaintext ended, which libsodium supports.
+void OnionEncrypt(const OfflineSecret* secrets, party_id_t first_party,
+                  party_id_t party_count, const std::vector<pkey_t>& pkeys,
+                  char* output, const OnionScheme& scheme) {
   // Compute how large the whole onion cipher is.
   party_id_t parties = party_count - first_party;
-  size_t total_size = CipherSize(parties);
-
-  // Allocate buffers for onion encryption.
-  char* output_buffer = new char[total_size];
-  char* input_buffer = new char[total_size];
-  char* swap = nullptr;
+  size_t total_size = CipherSize(parties, scheme);
+  size_t secret_size = SecretSize(scheme);
 
   size_t offset = total_size;
   for (party_id_t i = parties; i > 0; i--) {
     party_id_t idx = i - 1;
     party_id_t party_id = first_party + idx;
 
-    const unsigned char* secret =
-        reinterpret_cast<const unsigned char*>(secrets + idx);
-
-    offset -= sizeof(OfflineSecret);
-    memcpy(input_buffer + offset, secret, sizeof(OfflineSecret));
-    assert(crypto_box_seal(CAST(output_buffer) + offset - crypto_box_SEALBYTES,
-                           CCAST(input_buffer) + offset, total_size - offset,
-                           pkeys[party_id].data()) == 0);
-
+    offset -= secret_size;
+    memcpy(output + offset, secrets + idx, secret_size);
     offset -= crypto_box_SEALBYTES;
-    swap = output_buffer;
-    output_buffer = input_buffer;
-    input_buffer = swap;
+    SealLayer(CAST(output) + offset, total_size - offset - crypto_box_SEALBYTES,
+              pkeys[party_id], scheme.format);
   }
 
   // Sanity checks.
   assert(offset == 0);
+}
 
-  // Memory clean up
-  delete[] output_buffer;
-  return std::unique_ptr<char[]>(input_buffer);
+// Onion encrypt many ciphers.
+void OnionEncryptBatch(const OfflineSecret* secrets, index_t count,
+                       party_id_t first_party, party_id_t party_count,
+                       const std::vector<pkey_t>& pkeys, char* output,
+                       const OnionScheme& scheme) {
+  party_id_t parties = party_count - first_party;
+  size_t size = CipherSize(parties, scheme);
+  for (index_t i = 0; i < count; i++) {
+    OnionEncrypt(secrets + i * parties, first_party, party_count, pkeys,
+                 output + i * size, scheme);
+  }
 }
 
 // Onion decrypt (one layer).
 OnionLayer OnionDecrypt(const char* cipher, party_id_t party_count,
-                        const pkey_t& p, const skey_t& s) {
+                        const pkey_t& p, const skey_t& s,
+                        const OnionScheme& scheme) {
   // Compute how large the whole onion cipher is.
-  size_t sz = CipherSize(party_count);
-  char* plain = new char[sz - crypto_box_SEALBYTES];
+  size_t sz = CipherSize(party_count, scheme);
+  size_t plain_sz = sz - crypto_box_SEALBYTES;
+  // Msg() must be addressable as a whole OfflineSecret.
+  if (plain_sz < sizeof(OfflineSecret)) {
+    plain_sz = sizeof(OfflineSecret);
+  }
+  char* plain = new char[plain_sz];
 
   // Decrypt one layer.
-  auto status =
-      crypto_box_seal_open(CAST(plain), CCAST(cipher), sz, p.data(), s.data());
-  assert(status == 0);
+  OpenLayer(CAST(plain), CCAST(cipher), sz, p, s, scheme.format);
+
+  return OnionLayer(std::unique_ptr<char[]>(plain), SecretSize(scheme));
+}
 
-  return OnionLayer(std::unique_ptr<char[]>(plain));
+// Onion decrypt (one layer) in place.
+void OnionDecrypt(char* cipher, party_id_t party_count, const pkey_t& p,
+                  const skey_t& s, OfflineSecret* msg, char* next_layer,
+                  const OnionScheme& scheme) {
+  // Compute how large the whole onion cipher is.
+  size_t sz = CipherSize(party_count, scheme);
+  size_t secret_size = SecretSize(scheme);
+  char* plain = cipher + crypto_box_SEALBYTES;
+
+  // Decrypt one layer.
+  OpenLayer(CAST(plain), CCAST(cipher), sz, p, s, scheme.format);
+
+  // Copy out components. The next layer may overlap this cipher.
+  memcpy(msg, plain, secret_size);
+  if (party_count > 1) {
+    memmove(next_layer, plain + secret_size,
+            CipherSize(party_count - 1, scheme));
+  }
+}
+
+// Onion decrypt (one layer) many ciphers.
+void OnionDecryptBatch(char* ciphers, index_t count, party_id_t party_count,
+                       const pkey_t& p, const skey_t& s, OfflineSecret* msgs,
+                       char* next_layers, const OnionScheme& scheme) {
+  size_t size = CipherSize(party_count, scheme);
+  size_t next_size = CipherSize(party_count - 1, scheme);
+  for (index_t i = 0; i < count; i++) {
+    char* next = party_count > 1 ? next_layers + i * next_size : nullptr;
+    OnionDecrypt(ciphers + i * size, party_count, p, s, msgs + i, next, scheme);
+  }
 }
 
 }  // namespace onion
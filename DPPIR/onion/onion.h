@@ -14,14 +14,50 @@ namespace onion {
 // Generate key pair.
 void GenerateKeyPair(pkey_t* pkey, skey_t* skey);
 
-// Compute size of an onion cipher.
-size_t CipherSize(party_id_t party_count);
+// Whether the given format can be used on this machine (AES-GCM needs
+// hardware support).
+bool IsAvailable(OnionFormat format);
+
+// Size of the OfflineSecret part of a single layer.
+size_t SecretSize(const OnionScheme& scheme);
+
+// Compute size of an onion cipher (the same for all formats).
+size_t CipherSize(party_id_t party_count,
+                  const OnionScheme& scheme = OnionScheme());
+
+// Upper bound on the number of precomputed ephemeral key pairs (64 bytes
+// each).
+#define KEY_POOL_CAPACITY (1 << 21)
+
+// Starts threads precomputing up to capacity ephemeral key pairs (one is used
+// per layer), which OnionEncrypt() then uses instead of generating them
+// inline. Meant to be called before waiting on other parties.
+void StartKeyPool(size_t capacity, unsigned threads);
+
+// Stops precomputing key pairs, e.g. before entering a CPU-heavy stage.
+// Already computed pairs remain available to OnionEncrypt().
+void StopKeyPool();
 
 // Onion encrypt.
+// The scheme must match the one used by all parties (see config).
 std::unique_ptr<char[]> OnionEncrypt(const OfflineSecret* messages,
                                      party_id_t first_party,
                                      party_id_t party_count,
-                                     const std::vector<pkey_t>& pkeys);
+                                     const std::vector<pkey_t>& pkeys,
+                                     const OnionScheme& scheme = OnionScheme());
+
+// Onion encrypt into a caller-owned buffer of size
+// CipherSize(party_count - first_party, scheme) (no allocation).
+void OnionEncrypt(const OfflineSecret* messages, party_id_t first_party,
+                  party_id_t party_count, const std::vector<pkey_t>& pkeys,
+                  char* output, const OnionScheme& scheme = OnionScheme());
+
+// Onion encrypt count ciphers into consecutive slots of output.
+// messages holds (party_count - first_party) secrets per cipher.
+void OnionEncryptBatch(const OfflineSecret* messages, index_t count,
+                       party_id_t first_party, party_id_t party_count,
+                       const std::vector<pkey_t>& pkeys, char* output,
+                       const OnionScheme& scheme = OnionScheme());
 
 // Efficient onion decryption data structure:
 // avoids an extra copy of the OfflineSecret and of the buffer, and
@@ -29,20 +65,41 @@ std::unique_ptr<char[]> OnionEncrypt(const OfflineSecret* messages,
 class OnionLayer {
  public:
   // Basically a wrapper around a buffer.
-  explicit OnionLayer(std::unique_ptr<char[]>&& buf) : buf_(std::move(buf)) {}
+  // With seeded preshares, only the seed prefix of Msg().preshare is valid.
+  OnionLayer(std::unique_ptr<char[]>&& buf, size_t secret_size)
+      : buf_(std::move(buf)), secret_size_(secret_size) {}
   // Get components (no copy).
   OfflineSecret& Msg() {
     return *reinterpret_cast<OfflineSecret*>(this->buf_.get());
   }
-  char* NextLayer() { return buf_.get() + sizeof(OfflineSecret); }
+  char* NextLayer() { return buf_.get() + this->secret_size_; }
 
  private:
   std::unique_ptr<char[]> buf_;
+  size_t secret_size_;
 };
 
 // Onion decrypt (one layer).
 OnionLayer OnionDecrypt(const char* cipher, party_id_t party_count,
-                        const pkey_t& p, const skey_t& s);
+                        const pkey_t& p, const skey_t& s,
+                        const OnionScheme& scheme = OnionScheme());
+
+// Onion decrypt (one layer) without allocating: cipher is decrypted in place
+// (and is garbage afterwards), the secret is copied to msg and the next
+// layer to next_layer. next_layer may overlap cipher (e.g. in a CipherBatch),
+// and may be null if this is the last layer.
+void OnionDecrypt(char* cipher, party_id_t party_count, const pkey_t& p,
+                  const skey_t& s, OfflineSecret* msg, char* next_layer,
+                  const OnionScheme& scheme = OnionScheme());
+
+// Onion decrypt (one layer) count consecutive ciphers.
+// Secrets are written to msgs and next layers to consecutive slots of
+// next_layers. Ciphers are processed in order, so next_layers may overlap
+// ciphers as long as it does not start after them (e.g. in a CipherBatch).
+void OnionDecryptBatch(char* ciphers, index_t count, party_id_t party_count,
+                       const pkey_t& p, const skey_t& s, OfflineSecret* msgs,
+                       char* next_layers,
+                       const OnionScheme& scheme = OnionScheme());
 
 }  // namespace onion
 }  // namespace DPPIR
@@ -0,0 +1,162 @@
+// Measures the offline throughput of onion ciphers per format and number of
+// parties: creating full onion ciphers (client/noise), and peeling one layer
+// (party), both one cipher at a time on a single thread and batched over the
+// thread pool.
+//
+// Usage: onion_benchmark [--ciphers=<n>] [--threads=<n>]
+// --threads=0 (the default) uses all cores for the batched mode.
+
+#include <cassert>
+// NOLINTNEXTLINE
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DPPIR/onion/onion.h"
+#include "DPPIR/parallel/parallel.h"
+#include "DPPIR/types/types.h"
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+#define MIN_PARTIES 2
+#define MAX_PARTIES 8
+
+namespace DPPIR {
+namespace onion {
+
+using micros = std::chrono::microseconds;
+
+const char* FormatName(OnionFormat format) {
+  switch (format) {
+    case OnionFormat::kSealed:
+      return "sealed";
+    case OnionFormat::kHybridXChaCha20:
+      return "xchacha20";
+    case OnionFormat::kHybridAesGcm:
+      return "aesgcm";
+  }
+  return "";
+}
+
+// Prints ciphers/sec and bytes/sec (of input ciphers) for one measurement.
+void Report(const char* label, index_t count, size_t size, double us) {
+  double seconds = us / 1000000.0;
+  std::cout << "  " << label << ": " << count / seconds << " ciphers/s, "
+            << count * size / seconds / (1 << 20) << " MiB/s" << std::endl;
+}
+
+void Benchmark(party_id_t parties, const OnionScheme& scheme, index_t count) {
+  // Generate key pairs.
+  std::vector<pkey_t> pkeys(parties);
+  std::vector<skey_t> skeys(parties);
+  for (party_id_t i = 0; i < parties; i++) {
+    GenerateKeyPair(&pkeys[i], &skeys[i]);
+  }
+
+  // Secrets content does not matter.
+  std::unique_ptr<OfflineSecret[]> secrets =
+      std::make_unique<OfflineSecret[]>(count * parties);
+  randombytes_buf(secrets.get(), sizeof(OfflineSecret) * count * parties);
+
+  size_t size = CipherSize(parties, scheme);
+  size_t next_size = CipherSize(parties - 1, scheme);
+  std::unique_ptr<char[]> ciphers = std::make_unique<char[]>(count * size);
+  std::unique_ptr<char[]> next =
+      std::make_unique<char[]>(count * next_size + 1);
+  std::unique_ptr<OfflineSecret[]> msgs =
+      std::make_unique<OfflineSecret[]>(count);
+
+  std::cout << int(parties) << " parties, " << FormatName(scheme.format)
+            << (scheme.seeded ? " (seeded)" : "") << ", " << size
+            << " bytes/cipher:" << std::endl;
+
+  // Encrypt one cipher at a time.
+  auto start = std::chrono::steady_clock::now();
+  for (index_t i = 0; i < count; i++) {
+    OnionEncrypt(secrets.get() + i * parties, 0, parties, pkeys,
+                 ciphers.get() + i * size, scheme);
+  }
+  auto end = std::chrono::steady_clock::now();
+  Report("encrypt (single)", count, size,
+         std::chrono::duration_cast<micros>(end - start).count());
+
+  // Encrypt in parallel batches.
+  start = std::chrono::steady_clock::now();
+  parallel::ParallelFor(count, [&](unsigned, index_t s, index_t e) {
+    OnionEncryptBatch(secrets.get() + s * parties, e - s, 0, parties, pkeys,
+                      ciphers.get() + s * size, scheme);
+  });
+  end = std::chrono::steady_clock::now();
+  Report("encrypt (batch)", count, size,
+         std::chrono::duration_cast<micros>(end - start).count());
+
+  // Decrypt first layer one cipher at a time. Decryption is in place, so
+  // keep a copy of the ciphers for the batched run.
+  std::unique_ptr<char[]> copy = std::make_unique<char[]>(count * size);
+  memcpy(copy.get(), ciphers.get(), count * size);
+  start = std::chrono::steady_clock::now();
+  for (index_t i = 0; i < count; i++) {
+    OnionDecrypt(ciphers.get() + i * size, parties, pkeys[0], skeys[0],
+                 msgs.get() + i, next.get() + i * next_size, scheme);
+  }
+  end = std::chrono::steady_clock::now();
+  Report("decrypt layer (single)", count, size,
+         std::chrono::duration_cast<micros>(end - start).count());
+
+  // Decrypt first layer in parallel batches.
+  start = std::chrono::steady_clock::now();
+  parallel::ParallelFor(count, [&](unsigned, index_t s, index_t e) {
+    OnionDecryptBatch(copy.get() + s * size, e - s, parties, pkeys[0],
+                      skeys[0], msgs.get() + s, next.get() + s * next_size,
+                      scheme);
+  });
+  end = std::chrono::steady_clock::now();
+  Report("decrypt layer (batch)", count, size,
+         std::chrono::duration_cast<micros>(end - start).count());
+}
+
+}  // namespace onion
+}  // namespace DPPIR
+
+int main(int argc, char** argv) {
+  assert(sodium_init() >= 0);
+
+  // Parse flags.
+  DPPIR::index_t ciphers = 5000;
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.rfind("--ciphers=", 0) == 0) {
+      ciphers = std::atoi(argv[i] + strlen("--ciphers="));
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      threads = std::atoi(argv[i] + strlen("--threads="));
+    } else {
+      std::cout << "Usage: " << argv[0] << " [--ciphers=<n>] [--threads=<n>]"
+                << std::endl;
+      return 1;
+    }
+  }
+  assert(ciphers > 0);
+  if (threads > 0) {
+    DPPIR::parallel::SetThreadCount(threads);
+  }
+  std::cout << ciphers << " ciphers, batches over "
+            << DPPIR::parallel::ThreadCount() << " threads" << std::endl;
+
+  const DPPIR::OnionFormat formats[3] = {DPPIR::OnionFormat::kSealed,
+                                         DPPIR::OnionFormat::kHybridXChaCha20,
+                                         DPPIR::OnionFormat::kHybridAesGcm};
+  for (DPPIR::party_id_t p = MIN_PARTIES; p <= MAX_PARTIES; p++) {
+    for (DPPIR::OnionFormat format : formats) {
+      if (DPPIR::onion::IsAvailable(format)) {
+        DPPIR::onion::Benchmark(p, {format, false}, ciphers);
+        DPPIR::onion::Benchmark(p, {format, true}, ciphers);
+      }
+    }
+  }
+  return 0;
+}
@@ -1,11 +1,15 @@
 #include "DPPIR/onion/onion.h"
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <memory>
+// NOLINTNEXTLINE
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "DPPIR/onion/key_pool.h"
 #include "DPPIR/sharing/additive.h"
 #include "DPPIR/sharing/incremental.h"
 #include "DPPIR/types/types.h"
@@ -39,7 +43,7 @@ std::unique_ptr<OfflineSecret[]> SampleSecrets() {
 std::unique_ptr<OfflineSecret[]> OnionDecryptAll(
     const char* cipher, const std::vector<pkey_t> pkeys,
     const std::vector<skey_t> skeys) {
-  OnionLayer layer(nullptr);
+  OnionLayer layer(nullptr, 0);
   std::unique_ptr<OfflineSecret[]> result =
       std::make_unique<OfflineSecret[]>(PARTIES);
   for (party_id_t party = 0; party < PARTIES; party++) {
@@ -52,8 +56,9 @@ std::unique_ptr<OfflineSecret[]> OnionDecryptAll(
   return result;
 }
 
-bool Equals(const OfflineSecret* left, const OfflineSecret* right) {
-  for (party_id_t i = 0; i < PARTIES; i++) {
+bool Equals(const OfflineSecret* left, const OfflineSecret* right,
+            party_id_t count = PARTIES) {
+  for (party_id_t i = 0; i < count; i++) {
     if (left[i].tag != right[i].tag) {
       return false;
     }
@@ -78,6 +83,82 @@ bool Equals(const OfflineSecret* left, const OfflineSecret* right) {
   return true;
 }
 
+// Encrypt a batch of ciphers, then peel them off one layer at a time using
+// the allocation-free API.
+bool TestBatch(const std::vector<pkey_t>& pkeys,
+               const std::vector<skey_t>& skeys, const OnionScheme& scheme) {
+  index_t count = 50;
+  std::unique_ptr<OfflineSecret[]> plain =
+      std::make_unique<OfflineSecret[]>(count * PARTIES);
+  for (index_t i = 0; i < count; i++) {
+    std::unique_ptr<OfflineSecret[]> secrets = SampleSecrets();
+    for (party_id_t party = 0; party < PARTIES; party++) {
+      plain[i * PARTIES + party] = secrets[party];
+    }
+  }
+
+  // Encrypt.
+  std::unique_ptr<char[]> ciphers =
+      std::make_unique<char[]>(count * CipherSize(PARTIES, scheme));
+  OnionEncryptBatch(plain.get(), count, 0, PARTIES, pkeys, ciphers.get(),
+                    scheme);
+
+  // Must match the single cipher API.
+  std::unique_ptr<char[]> single =
+      OnionEncrypt(plain.get(), 0, PARTIES, pkeys, scheme);
+  OnionLayer layer =
+      OnionDecrypt(single.get(), PARTIES, pkeys[0], skeys[0], scheme);
+  if (memcmp(&layer.Msg(), plain.get(), SecretSize(scheme)) != 0) {
+    return false;
+  }
+
+  // Decrypt.
+  std::unique_ptr<OfflineSecret[]> msgs =
+      std::make_unique<OfflineSecret[]>(count);
+  for (party_id_t party = 0; party < PARTIES; party++) {
+    party_id_t layers = PARTIES - party;
+    std::unique_ptr<char[]> next =
+        std::make_unique<char[]>(count * CipherSize(layers - 1, scheme) + 1);
+    OnionDecryptBatch(ciphers.get(), count, layers, pkeys.at(party),
+                      skeys.at(party), msgs.get(), next.get(), scheme);
+    for (index_t i = 0; i < count; i++) {
+      // With seeded preshares, only a prefix of the secret is transmitted.
+      const OfflineSecret& expected = plain[i * PARTIES + party];
+      if (memcmp(&msgs[i], &expected, SecretSize(scheme)) != 0) {
+        return false;
+      }
+    }
+    ciphers = std::move(next);
+  }
+  return true;
+}
+
+// Every precomputed pair is handed out once, and matches its secret key.
+bool TestKeyPool() {
+  size_t capacity = 20;
+  KeyPool pool;
+  pool.Start(capacity, 3);
+  std::vector<EphemeralKeyPair> pairs(capacity);
+  for (size_t i = 0; i < capacity; i++) {
+    while (!pool.Take(&pairs[i])) {
+      std::this_thread::yield();
+    }
+    pkey_t pkey;
+    crypto_scalarmult_base(pkey.data(), pairs[i].skey.data());
+    if (pkey != pairs[i].pkey) {
+      return false;
+    }
+    for (size_t j = 0; j < i; j++) {
+      if (pairs[j].pkey == pairs[i].pkey) {
+        return false;
+      }
+    }
+  }
+  pool.Stop();
+  EphemeralKeyPair pair;
+  return !pool.Take(&pair);
+}
+
 }  // namespace onion
 }  // namespace DPPIR
 
@@ -106,6 +187,40 @@ int main() {
     }*/
   }
 
+  // Test all schemes supported by this machine.
+  const DPPIR::OnionFormat formats[3] = {
+      DPPIR::OnionFormat::kSealed, DPPIR::OnionFormat::kHybridXChaCha20,
+      DPPIR::OnionFormat::kHybridAesGcm};
+  for (DPPIR::OnionFormat format : formats) {
+    if (!DPPIR::onion::IsAvailable(format)) {
+      std::cout << "Skipping unsupported format " << static_cast<int>(format)
+                << std::endl;
+      continue;
+    }
+    for (bool seeded : {false, true}) {
+      if (!DPPIR::onion::TestBatch(pkeys, skeys, {format, seeded})) {
+        std::cout << "Test failed! (format " << static_cast<int>(format)
+                  << ", seeded " << seeded << ")" << std::endl;
+        return 1;
+      }
+      // Again, with (some) precomputed ephemeral keys.
+      DPPIR::onion::StartKeyPool(100, 2);
+      bool passed = DPPIR::onion::TestBatch(pkeys, skeys, {format, seeded});
+      DPPIR::onion::StopKeyPool();
+      if (!passed) {
+        std::cout << "Test failed with key pool! (format "
+                  << static_cast<int>(format) << ", seeded " << seeded << ")"
+                  << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  if (!DPPIR::onion::TestKeyPool()) {
+    std::cout << "Key pool test failed!" << std::endl;
+    return 1;
+  }
+
   std::cout << "All tests passed!" << std::endl;
 
   return 0;
@@ -0,0 +1,173 @@
+#include "DPPIR/parallel/parallel.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+// NOLINTNEXTLINE
+#include <thread>
+#include <vector>
+
+namespace DPPIR {
+namespace parallel {
+
+namespace {
+
+// Chunk of [0, count) assigned to thread tid out of threads.
+inline index_t ChunkStart(index_t count, unsigned tid, unsigned threads) {
+  return static_cast<uint64_t>(count) * tid / threads;
+}
+
+// Set while a thread is executing a job, so that nested ParallelFor() calls
+// do not wait on the (busy) pool.
+thread_local bool in_job = false;
+
+// Persistent workers: spawning threads per call is too slow for the many
+// small jobs issued while reading from sockets.
+class Pool {
+ public:
+  explicit Pool(unsigned threads)
+      : threads_(threads),
+        job_(nullptr),
+        count_(0),
+        generation_(0),
+        pending_(0),
+        stop_(false) {
+    for (unsigned tid = 1; tid < threads; tid++) {
+      this->workers_.emplace_back(&Pool::Work, this, tid);
+    }
+  }
+
+  ~Pool() {
+    {
+      std::lock_guard<std::mutex> lock(this->mtx_);
+      this->stop_ = true;
+    }
+    this->start_cv_.notify_all();
+    for (std::thread& worker : this->workers_) {
+      worker.join();
+    }
+  }
+
+  unsigned Threads() const { return this->threads_; }
+
+  void Run(index_t count, const Job& f) {
+    // Only one job at a time.
+    std::lock_guard<std::mutex> run_lock(this->run_mtx_);
+    {
+      std::lock_guard<std::mutex> lock(this->mtx_);
+      this->job_ = &f;
+      this->count_ = count;
+      this->pending_ = this->threads_ - 1;
+      this->generation_++;
+    }
+    this->start_cv_.notify_all();
+
+    // The calling thread takes the first chunk.
+    this->RunChunk(0);
+
+    // Wait for workers.
+    std::unique_lock<std::mutex> lock(this->mtx_);
+    this->done_cv_.wait(lock, [this] { return this->pending_ == 0; });
+    this->job_ = nullptr;
+  }
+
+ private:
+  unsigned threads_;
+  std::vector<std::thread> workers_;
+  std::mutex run_mtx_;
+  std::mutex mtx_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  // Current job.
+  const Job* job_;
+  index_t count_;
+  uint64_t generation_;
+  unsigned pending_;
+  bool stop_;
+
+  void RunChunk(unsigned tid) {
+    index_t start = ChunkStart(this->count_, tid, this->threads_);
+    index_t end = ChunkStart(this->count_, tid + 1, this->threads_);
+    if (start < end) {
+      in_job = true;
+      (*this->job_)(tid, start, end);
+      in_job = false;
+    }
+  }
+
+  void Work(unsigned tid) {
+    uint64_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(this->mtx_);
+        this->start_cv_.wait(lock, [&, this] {
+          return this->stop_ || this->generation_ != seen;
+        });
+        if (this->stop_) {
+          return;
+        }
+        seen = this->generation_;
+      }
+      this->RunChunk(tid);
+      {
+        std::lock_guard<std::mutex> lock(this->mtx_);
+        if (--this->pending_ == 0) {
+          this->done_cv_.notify_one();
+        }
+      }
+    }
+  }
+};
+
+std::unique_ptr<Pool> pool = nullptr;
+// ParallelFor() may be called from several threads.
+std::mutex pool_mtx;
+
+Pool* GetPool() {
+  std::lock_guard<std::mutex> lock(pool_mtx);
+  if (pool == nullptr) {
+    unsigned count = std::thread::hardware_concurrency();
+    pool = std::make_unique<Pool>(count > 0 ? count : 1);
+  }
+  return pool.get();
+}
+
+}  // namespace
+
+void SetThreadCount(unsigned count) {
+  std::lock_guard<std::mutex> lock(pool_mtx);
+  pool = nullptr;
+  pool = std::make_unique<Pool>(count > 0 ? count : 1);
+}
+
+unsigned ThreadCount() { return GetPool()->Threads(); }
+
+void ParallelFor(index_t count, const Job& f) {
+  if (count == 0) {
+    return;
+  }
+  Pool* p = GetPool();
+  if (in_job || p->Threads() == 1 || count == 1) {
+    f(0, 0, count);
+    return;
+  }
+  p->Run(count, f);
+}
+
+void Counter::Add(index_t count) {
+  {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    this->value_ += count;
+  }
+  this->cv_.notify_all();
+}
+
+index_t Counter::WaitForMore(index_t value) {
+  std::unique_lock<std::mutex> lock(this->mtx_);
+  this->cv_.wait(lock, [&, this] { return this->value_ > value; });
+  return this->value_;
+}
+
+}  // namespace parallel
+}  // namespace DPPIR
@@ -0,0 +1,52 @@
+// Thread pool used to spread CPU-heavy loops (e.g. onion crypto) over cores.
+#ifndef DPPIR_PARALLEL_PARALLEL_H_
+#define DPPIR_PARALLEL_PARALLEL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include "DPPIR/types/types.h"
+
+// Maximum number of ciphers decrypted in a single parallel wave.
+#define DECRYPT_WINDOW (1 << 18)
+// Number of ciphers encrypted in a single parallel wave.
+#define ENCRYPT_WINDOW (1 << 16)
+
+namespace DPPIR {
+namespace parallel {
+
+// Number of threads used by ParallelFor(), including the calling thread.
+// Defaults to the number of hardware threads.
+void SetThreadCount(unsigned count);
+unsigned ThreadCount();
+
+// Splits [0, count) into ThreadCount() contiguous chunks and calls
+// f(thread_id, start, end) for every non-empty chunk in parallel.
+// Blocks until all chunks are done. Nested calls from inside f run serially.
+using Job = std::function<void(unsigned, index_t, index_t)>;
+void ParallelFor(index_t count, const Job& f);
+
+// Count of elements one thread has produced, which another thread waits on to
+// consume them as they come (e.g. ciphers that are still being received).
+class Counter {
+ public:
+  Counter() : value_(0) {}
+
+  // Producer: count more elements are ready.
+  void Add(index_t count);
+
+  // Consumer: blocks until more than value elements are ready, returns how
+  // many are.
+  index_t WaitForMore(index_t value);
+
+ private:
+  index_t value_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+}  // namespace parallel
+}  // namespace DPPIR
+
+#endif  // DPPIR_PARALLEL_PARALLEL_H_
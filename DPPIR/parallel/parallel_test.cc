@@ -0,0 +1,109 @@
+// Tests that ParallelFor() covers every index exactly once, for different
+// thread and element counts, including nested calls.
+
+#include "DPPIR/parallel/parallel.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+// NOLINTNEXTLINE
+#include <thread>
+
+#include "DPPIR/types/types.h"
+
+namespace DPPIR {
+namespace parallel {
+
+bool TestCoverage(unsigned threads, index_t count) {
+  SetThreadCount(threads);
+  std::unique_ptr<std::atomic<int>[]> hits =
+      std::make_unique<std::atomic<int>[]>(count);
+  for (index_t i = 0; i < count; i++) {
+    hits[i] = 0;
+  }
+
+  std::atomic<unsigned> max_tid = 0;
+  ParallelFor(count, [&](unsigned tid, index_t start, index_t end) {
+    if (tid > max_tid) {
+      max_tid = tid;
+    }
+    for (index_t i = start; i < end; i++) {
+      hits[i]++;
+    }
+  });
+
+  for (index_t i = 0; i < count; i++) {
+    if (hits[i] != 1) {
+      std::cout << "Index " << i << " hit " << hits[i] << " times"
+                << " (threads = " << threads << ", count = " << count << ")"
+                << std::endl;
+      return false;
+    }
+  }
+  if (max_tid >= threads) {
+    std::cout << "Thread id " << max_tid << " out of range" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool TestNested() {
+  SetThreadCount(4);
+  std::atomic<index_t> total = 0;
+  ParallelFor(10, [&](unsigned, index_t start, index_t end) {
+    for (index_t i = start; i < end; i++) {
+      ParallelFor(100, [&](unsigned, index_t s, index_t e) { total += e - s; });
+    }
+  });
+  if (total != 1000) {
+    std::cout << "Nested total is " << total << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool TestCounter() {
+  Counter counter;
+  std::thread producer([&]() {
+    for (int i = 0; i < 100; i++) {
+      counter.Add(10);
+    }
+  });
+  // Must eventually see everything, and never go backwards.
+  index_t seen = 0;
+  while (seen < 1000) {
+    index_t value = counter.WaitForMore(seen);
+    if (value <= seen || value > 1000) {
+      std::cout << "Counter went from " << seen << " to " << value
+                << std::endl;
+      producer.join();
+      return false;
+    }
+    seen = value;
+  }
+  producer.join();
+  return true;
+}
+
+}  // namespace parallel
+}  // namespace DPPIR
+
+int main() {
+  const unsigned threads[4] = {1, 2, 3, 8};
+  const DPPIR::index_t counts[5] = {1, 2, 7, 1000, 100003};
+  for (unsigned t : threads) {
+    for (DPPIR::index_t c : counts) {
+      if (!DPPIR::parallel::TestCoverage(t, c)) {
+        std::cout << "Test failed!" << std::endl;
+        return 1;
+      }
+    }
+  }
+  if (!DPPIR::parallel::TestNested() || !DPPIR::parallel::TestCounter()) {
+    std::cout << "Test failed!" << std::endl;
+    return 1;
+  }
+
+  std::cout << "All tests passed!" << std::endl;
+  return 0;
+}
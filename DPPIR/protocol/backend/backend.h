@@ -3,10 +3,12 @@
 
 #include <functional>
 #include <iostream>
+#include <vector>
 
 #include "DPPIR/config/config.h"
 #include "DPPIR/sockets/parallel_socket.h"
 #include "DPPIR/sockets/server_socket.h"
+#include "DPPIR/sockets/transport.h"
 #include "DPPIR/types/containers.h"
 #include "DPPIR/types/database.h"
 #include "DPPIR/types/state.h"
@@ -19,6 +21,10 @@ class BackendParty {
  public:
   BackendParty(server_id_t server_id, config::Config&& config, Database&& db);
 
+  // Send batches with MSG_ZEROCOPY where the kernel supports it (see
+  // sockets::Transport::SendDirect()).
+  void SetZeroCopy(bool zerocopy) { this->transport_.SetZeroCopy(zerocopy); }
+
   // Start the protocol.
   void Start(bool offline, bool online) {
     if (offline) {
@@ -36,6 +42,8 @@ class BackendParty {
   party_id_t party_id_;
   server_id_t server_id_;
   server_id_t server_count_;
+  // Event loop shared by all sockets.
+  sockets::Transport transport_;
   // Socket from previous party.
   sockets::ServerSocket back_;
   // Socket to siblings if any exist (only for sharing offline secrets).
@@ -52,6 +60,10 @@ class BackendParty {
   Batch<Query> queries_;
   // Offline state.
   BackendState state_;
+  // Scratch space for handling a chunk of queries at once.
+  std::vector<incremental_share_t> chunk_shares_;
+  std::vector<incremental_tally_t> chunk_keys_;
+  std::vector<preshare_t> chunk_preshares_;
 
   // Initialization.
   void InitializeBatch();
@@ -70,8 +82,10 @@ class BackendParty {
   void StartOnline();
 
   // Handlers.
-  void HandleOnionCipher(const char* cipher);
-  Response HandleQuery(const Query& query);
+  void HandleOnionCiphers(char* ciphers, index_t count, OfflineSecret* out);
+  // Handles count queries, writing their responses to responses.
+  void HandleQueries(const Query* queries, index_t count,
+                     Response* responses);
 
 #include "DPPIR/protocol/parallel_party/parallel_party_util.inc"
 };
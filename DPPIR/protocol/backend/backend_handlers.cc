@@ -6,32 +6,41 @@
 namespace DPPIR {
 namespace protocol {
 
-void BackendParty::HandleOnionCipher(const char* cipher) {
-  // Decrypt cipher.
-  onion::OnionLayer layer =
-      onion::OnionDecrypt(cipher, 1, this->party_config_.onion_pkey,
-                          this->party_config_.onion_skey);
-
-  // Install secret.
-  this->state_.Store(layer.Msg());
+void BackendParty::HandleOnionCiphers(char* ciphers, index_t count,
+                                      OfflineSecret* out) {
+  // Decrypt ciphers (in place).
+  onion::OnionDecryptBatch(ciphers, count, 1, this->party_config_.onion_pkey,
+                           this->party_config_.onion_skey, out, nullptr,
+                           this->config_.onion_scheme);
 }
 
-Response BackendParty::HandleQuery(const Query& query) {
-  // Load corresponding offline secret by tag.
-  this->state_.LoadSecret(query.tag);
-
-  // Reconstruct the database key.
-  const incremental_share_t& incremental = this->state_.GetIncremental();
-  key_t key = sharing::IncrementalReconstruct(query.tally, incremental);
-
-  // Lookup response.
-  const Response& value = this->db_.Lookup(key);
-
-  // Mask response.
-  Response response;
-  sharing::AdditiveReconstruct(value, this->state_.GetPreshare(), &response);
-
-  return response;
+void BackendParty::HandleQueries(const Query* queries, index_t count,
+                                 Response* responses) {
+  this->chunk_shares_.resize(count);
+  this->chunk_keys_.resize(count);
+  this->chunk_preshares_.resize(count);
+
+  // Load corresponding offline secrets by tag.
+  for (index_t i = 0; i < count; i++) {
+    this->state_.LoadSecret(queries[i].tag);
+    this->chunk_shares_[i] = this->state_.GetIncremental();
+    this->chunk_keys_[i] = queries[i].tally;
+    this->chunk_preshares_[i] = this->state_.GetPreshare();
+  }
+
+  // Reconstruct the database keys.
+  sharing::IncrementalReconstructBatch(this->chunk_keys_.data(),
+                                       this->chunk_shares_.data(), count,
+                                       this->chunk_keys_.data());
+
+  // Lookup responses.
+  for (index_t i = 0; i < count; i++) {
+    responses[i] = this->db_.Lookup(this->chunk_keys_[i]);
+  }
+
+  // Mask responses.
+  sharing::AdditiveReconstructBatch(responses, this->chunk_preshares_.data(),
+                                    count, responses);
 }
 
 }  // namespace protocol
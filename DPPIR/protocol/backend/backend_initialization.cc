@@ -14,9 +14,11 @@ BackendParty::BackendParty(server_id_t server_id, config::Config&& config,
       server_id_(server_id),
       server_count_(config.server_count),
       // Back socket only.
-      back_(onion::CipherSize(1)),
+      transport_(),
+      back_(onion::CipherSize(1, config.onion_scheme), &transport_),
       // Sibling information, in case we have parallel backends.
-      siblings_(this->server_id_, this->server_count_, onion::CipherSize(1)),
+      siblings_(this->server_id_, this->server_count_,
+                onion::CipherSize(1, config.onion_scheme), &transport_),
       received_from_sibling_counts_(server_count_, server_count_ + 1, 0),
       // Configuration
       config_(std::move(config)),
@@ -25,7 +27,11 @@ BackendParty::BackendParty(server_id_t server_id, config::Config&& config,
       // Database.
       db_(std::move(db)),
       // Offline state.
-      state_() {
+      state_(),
+      // Scratch space.
+      chunk_shares_(),
+      chunk_keys_(),
+      chunk_preshares_() {
   assert(config.party_count >= 2);
   // Initialize socket.
   this->back_.Initialize(this->server_config_.port);
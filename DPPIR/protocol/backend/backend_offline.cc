@@ -1,5 +1,7 @@
 #include <iostream>
+#include <vector>
 
+#include "DPPIR/parallel/parallel.h"
 #include "DPPIR/protocol/backend/backend.h"
 
 namespace DPPIR {
@@ -10,12 +12,21 @@ void BackendParty::CollectAndInstallSecrets() {
   std::cout << "Listening to " << this->queries_.Capacity()
             << " offline secrets..." << std::endl;
   index_t count = this->queries_.Capacity();
+  std::vector<OfflineSecret> secrets;
   while (count > 0) {
     CipherLogicalBuffer& buffer = this->back_.ReadCiphers(count);
-    for (char* cipher : buffer) {
-      this->HandleOnionCipher(cipher);
+    // Decrypt in parallel, install serially.
+    index_t size = buffer.Size();
+    if (secrets.size() < size) {
+      secrets.resize(size);
     }
-    count -= buffer.Size();
+    parallel::ParallelFor(size, [&, this](unsigned, index_t s, index_t e) {
+      this->HandleOnionCiphers(buffer[s], e - s, secrets.data() + s);
+    });
+    for (index_t i = 0; i < size; i++) {
+      this->state_.Store(secrets[i]);
+    }
+    count -= size;
     buffer.Clear();
   }
 }
@@ -41,10 +52,10 @@ void BackendParty::BroadcastSecrets() {
   size_t poll_rate = POLL_RATE / sizeof(OfflineSecret);
   this->SendAndPoll<OfflineSecret, SecretPair, BackendState>(
       &copy, poll_rate, copy.size(), total_count, from_counts,
-      std::function<void(const SecretPair&)>([this](const SecretPair& s) {
-        this->siblings_.BroadcastSecret(
-            {s.first, 0, s.second.incremental, s.second.preshare});
-      }),
+      std::function<void(const SecretPair&)>(
+          [this, &copy](const SecretPair& s) {
+            this->siblings_.BroadcastSecret(copy.Export(s));
+          }),
       std::function<index_t(server_id_t, index_t)>(
           [this](server_id_t source, index_t remaining) {
             LogicalBuffer<OfflineSecret>& buffer =
@@ -62,7 +73,7 @@ void BackendParty::BroadcastSecrets() {
 void BackendParty::StartOffline() {
   // Allocate memory and read batch size.
   this->InitializeBatch();
-  this->state_.Initialize(false);
+  this->state_.Initialize(false, this->config_.onion_scheme.seeded);
   this->back_.SendReady();
 
   // Initialize offline state.
@@ -82,7 +93,7 @@ void BackendParty::SimulateOffline() {
   this->InitializeBatch();
 
   // Simulate offline state.
-  this->state_.Initialize(true);
+  this->state_.Initialize(true, this->config_.onion_scheme.seeded);
 
   // Let previous party know we are ready to accept queries.
   this->back_.SendReady();
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "DPPIR/protocol/backend/backend.h"
+#include "DPPIR/sockets/consts.h"
 
 namespace DPPIR {
 namespace protocol {
@@ -23,11 +24,18 @@ void BackendParty::CollectQueries() {
 void BackendParty::SendResponses() {
   // Handle queries and send responses.
   std::cout << "Handling responses..." << std::endl;
-  for (Query& query : this->queries_) {
-    Response response = this->HandleQuery(query);
-    this->back_.SendResponse(response);
+  index_t size = this->queries_.Capacity();
+  Batch<Response> responses;
+  responses.Initialize(size);
+  // Handle a socket buffer worth of queries at a time.
+  index_t chunk = BUFFER_SIZE / sizeof(Response);
+  for (index_t start = 0; start < size; start += chunk) {
+    index_t count = size - start < chunk ? size - start : chunk;
+    this->HandleQueries(&this->queries_[start], count, &responses[start]);
   }
-  this->back_.FlushResponses();
+  // Send the whole batch at once: a zero copy send only returns once the
+  // peer acknowledged it, so sending chunk by chunk would stall on each.
+  this->back_.SendResponses(responses.begin(), size);
 }
 
 void BackendParty::StartOnline() {
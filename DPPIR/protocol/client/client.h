@@ -6,6 +6,7 @@
 
 #include "DPPIR/config/config.h"
 #include "DPPIR/sockets/client_socket.h"
+#include "DPPIR/sockets/transport.h"
 #include "DPPIR/types/database.h"
 #include "DPPIR/types/state.h"
 #include "DPPIR/types/types.h"
@@ -32,6 +33,8 @@ class Client {
  private:
   server_id_t server_id_;
   party_id_t party_count_;
+  // Event loop of the socket.
+  sockets::Transport transport_;
   // Socket to the frontend party.
   sockets::ClientSocket next_;
   // Network and protocol configuration.
@@ -44,6 +47,8 @@ class Client {
   std::vector<pkey_t> pkeys_;
   // How many queries we will be making.
   index_t queries_count_;
+  // Scratch space for reconstructing a chunk of responses at once.
+  std::vector<preshare_t> chunk_preshares_;
 
   // Offline.
   void StartOffline(index_t count);
@@ -56,9 +61,9 @@ class Client {
 
   // Handlers.
   tag_t SampleTag(index_t id);
-  std::unique_ptr<OfflineSecret[]> MakeSecret(index_t id);
+  void MakeSecret(index_t id, OfflineSecret* secrets);
   Query MakeQuery(key_t key);
-  void ReconstructResponse(Response* response);
+  void ReconstructResponses(Response* responses, index_t count);
 };
 
 }  // namespace protocol
@@ -1,5 +1,4 @@
 #include <memory>
-#include <utility>
 #include <vector>
 
 #include "DPPIR/protocol/client/client.h"
@@ -17,34 +16,29 @@ tag_t Client::SampleTag(index_t id) {
   return this->server_id_ * this->queries_count_ + id;
 }
 
-// Samples an offline secret, stores it in state, and returns it for
+// Samples an offline secret, stores it in state, and writes it to secrets for
 // use in the offline protocol.
-std::unique_ptr<OfflineSecret[]> Client::MakeSecret(index_t id) {
+void Client::MakeSecret(index_t id, OfflineSecret* secrets) {
   // Sample secret components.
   tag_t tag = this->SampleTag(id);
-  std::vector<incremental_share_t> incrementals =
-      sharing::PreIncrementalSecretShares(this->party_count_);
-  std::vector<preshare_t> preshares =
-      sharing::GenerateAdditiveSecretShares(this->party_count_ + 1);
+  Span<incremental_inverse_t> inverses = this->state_.IncrementalSlot(id);
 
   // Construct the secret of each party
-  std::unique_ptr<OfflineSecret[]> secrets =
-      std::make_unique<OfflineSecret[]>(this->party_count_);
   for (party_id_t party_id = 0; party_id < this->party_count_; party_id++) {
     OfflineSecret& secret = secrets[party_id];
     secret.tag = tag;
     secret.next_tag = this->SampleTag(id);
-    secret.share = incrementals.at(party_id);
-    secret.preshare = preshares.at(party_id);
+    incremental_share_t share;
+    sharing::PreIncrementalSecretShares(1, &share);
+    sharing::InvertIncrementalShares(&share, 1, &inverses[party_id]);
+    secret.share = share;
     tag = secret.next_tag;
   }
+  preshare_t preshare = sharing::GenerateAdditivePreshares(
+      this->party_count_ + 1, this->config_.onion_scheme.seeded, secrets);
 
   // Store relevant portion in client state.
-  this->state_.AddSecret(tag, std::move(incrementals),
-                         preshares.at(this->party_count_));
-
-  // Done!
-  return secrets;
+  this->state_.AddSecret(id, tag, preshare);
 }
 
 // Makes a query using an offline secret.
@@ -53,17 +47,24 @@ Query Client::MakeQuery(key_t key) {
   this->state_.LoadNext();
   // Query components.
   const tag_t& tag = this->state_.GetTag();
-  incremental_tally_t tally = sharing::GenerateIncrementalTally(
-      key, this->state_.GetIncrementalShares());
+  Span<const incremental_inverse_t> inverses =
+      this->state_.GetIncrementalShares();
+  incremental_tally_t tally =
+      sharing::GenerateIncrementalTally(key, inverses.data(), inverses.size());
   return {tag, tally};
 }
 
-// Reconstructs a response (in place).
-void Client::ReconstructResponse(Response* response) {
-  // Load offline secret of this response.
-  this->state_.LoadNext();
+// Reconstructs the next count responses (in place).
+void Client::ReconstructResponses(Response* responses, index_t count) {
+  // Load the offline secrets of these responses.
+  this->chunk_preshares_.resize(count);
+  for (index_t i = 0; i < count; i++) {
+    this->state_.LoadNext();
+    this->chunk_preshares_[i] = this->state_.GetPreshare();
+  }
   // Reconstruct.
-  sharing::AdditiveReconstruct(*response, this->state_.GetPreshare(), response);
+  sharing::AdditiveReconstructBatch(responses, this->chunk_preshares_.data(),
+                                    count, responses);
 }
 
 }  // namespace protocol
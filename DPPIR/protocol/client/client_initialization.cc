@@ -12,14 +12,16 @@ Client::Client(server_id_t server_id, config::Config&& config, Database&& db)
     : server_id_(server_id),
       party_count_(config.party_count),
       // Socket to first party only
-      next_(onion::CipherSize(party_count_)),
+      transport_(),
+      next_(onion::CipherSize(party_count_, config.onion_scheme), &transport_),
       // Configuration and database.
       config_(std::move(config)),
       db_(std::move(db)),
       // Offline state.
       state_(),
       // Primary keys.
-      pkeys_() {
+      pkeys_(),
+      chunk_preshares_() {
   assert(this->party_count_ >= 2);
   // Primary keys.
   for (config::PartyConfig& party : this->config_.parties) {
@@ -2,6 +2,7 @@
 #include <memory>
 
 #include "DPPIR/onion/onion.h"
+#include "DPPIR/parallel/parallel.h"
 #include "DPPIR/protocol/client/client.h"
 
 namespace DPPIR {
@@ -12,23 +13,45 @@ void Client::StartOffline(index_t count) {
 
   // Make count queries.
   std::cout << "Offline Queries: " << count << std::endl;
+
+  // Precompute ephemeral keys while the parties create their noise.
+  onion::StartKeyPool(count * this->party_count_, parallel::ThreadCount());
   this->next_.SendCount(count);
   this->next_.WaitForReady();
+  onion::StopKeyPool();
 
   // Initialize the state.
   this->state_.Initialize(this->party_count_, count, false, false);
 
-  // Sample offline secrets.
-  for (index_t i = 0; i < count; i++) {
-    // Sample secrets.
-    std::unique_ptr<OfflineSecret[]> secrets = this->MakeSecret(i);
+  // Sample offline secrets and encrypt them in parallel, then send them to the
+  // first party in order.
+  size_t cipher_size =
+      onion::CipherSize(this->party_count_, this->config_.onion_scheme);
+  std::unique_ptr<char[]> ciphers =
+      std::make_unique<char[]>(ENCRYPT_WINDOW * cipher_size);
+  for (index_t start = 0; start < count; start += ENCRYPT_WINDOW) {
+    index_t size = count - start;
+    if (size > ENCRYPT_WINDOW) {
+      size = ENCRYPT_WINDOW;
+    }
+    parallel::ParallelFor(size, [&, this](unsigned, index_t s, index_t e) {
+      std::unique_ptr<OfflineSecret[]> secrets =
+          std::make_unique<OfflineSecret[]>(this->party_count_);
+      for (index_t i = s; i < e; i++) {
+        // Sample secrets.
+        this->MakeSecret(start + i, secrets.get());
 
-    // Onion encrypt secrets.
-    std::unique_ptr<char[]> cipher =
-        onion::OnionEncrypt(secrets.get(), 0, this->party_count_, this->pkeys_);
+        // Onion encrypt secrets.
+        onion::OnionEncrypt(secrets.get(), 0, this->party_count_,
+                            this->pkeys_, ciphers.get() + i * cipher_size,
+                            this->config_.onion_scheme);
+      }
+    });
 
     // Send to first party via socket.
-    this->next_.SendCipher(cipher.get());
+    for (index_t i = 0; i < size; i++) {
+      this->next_.SendCipher(ciphers.get() + i * cipher_size);
+    }
   }
 
   // Wait until offline stage is finished before starting online.
@@ -32,12 +32,13 @@ void Client::StartOnline(index_t count) {
   index_t read = 0;
   while (read < count) {
     LogicalBuffer<Response>& buffer = this->next_.ReadResponses(count - read);
+
+    // Reconstruct.
+    this->ReconstructResponses(buffer.begin(), buffer.Size());
+
     for (index_t i = 0; i < buffer.Size(); i++) {
       Response& response = buffer[i];
 
-      // Reconstruct.
-      this->ReconstructResponse(&response);
-
       // Verify signature.
       // TODO(babman): signature.
 
@@ -0,0 +1,113 @@
+// NOLINTNEXTLINE
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "DPPIR/noise/noise.h"
+#include "DPPIR/onion/onion.h"
+#include "DPPIR/parallel/parallel.h"
+#include "DPPIR/protocol/noise_store/noise_store.h"
+#include "DPPIR/sharing/additive.h"
+#include "DPPIR/sharing/incremental.h"
+
+namespace DPPIR {
+namespace protocol {
+
+using millis = std::chrono::milliseconds;
+
+tag_t MakeNoiseSecret(const config::Config& config, party_id_t party_id,
+                      server_id_t server_id, index_t id,
+                      OfflineSecret* secrets,
+                      incremental_inverse_t* inverses) {
+  party_id_t remaining_parties = config.party_count - party_id - 1;
+
+  // Construct the secret of each party
+  tag_t tag = NoiseTag(party_id, server_id, id);
+  for (party_id_t party = 0; party < remaining_parties; party++) {
+    OfflineSecret& secret = secrets[party];
+    secret.tag = tag;
+    secret.next_tag = NoiseTag(party_id, server_id, id);
+    incremental_share_t share;
+    sharing::PreIncrementalSecretShares(1, &share);
+    sharing::InvertIncrementalShares(&share, 1, &inverses[party]);
+    secret.share = share;
+    tag = secret.next_tag;
+  }
+  // The last preshare is not needed: responses to noise are discarded.
+  sharing::GenerateAdditivePreshares(remaining_parties + 1,
+                                     config.onion_scheme.seeded, secrets);
+  return tag;
+}
+
+bool PrecomputeNoise(const config::Config& config, party_id_t party_id,
+                     server_id_t server_id, NoiseStore* store, index_t count) {
+  party_id_t remaining_parties = config.party_count - party_id - 1;
+  noise::NoiseDistribution distribution(config.epsilon, config.delta,
+                                        config.sample_noise,
+                                        config.noise_mechanism);
+  std::vector<pkey_t> pkeys;
+  for (const config::PartyConfig& party : config.parties) {
+    pkeys.push_back(party.onion_pkey);
+  }
+  std::vector<index_t> weights =
+      config::ServerWeights(config.parties.at(party_id));
+  auto range =
+      noise::FindRange(server_id, config.server_count, config.db_size, weights);
+  key_t size = range.second - range.first;
+
+  for (index_t ready = store->Count(); ready < count; ready++) {
+    std::cout << "Precomputing noise slot " << (ready + 1) << "/" << count
+              << "..." << std::endl;
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Sample the noise per element in domain, and find the key of every
+    // noise query.
+    std::unique_ptr<sample_t[]> samples = std::make_unique<sample_t[]>(size);
+    distribution.SampleBatch(samples.get(), size);
+    index_t noise_count = 0;
+    for (key_t i = 0; i < size; i++) {
+      noise_count += samples[i];
+    }
+    std::unique_ptr<key_t[]> keys = std::make_unique<key_t[]>(noise_count);
+    index_t idx = 0;
+    for (key_t key = range.first; key < range.second; key++) {
+      for (sample_t j = 0; j < samples[key - range.first]; j++) {
+        keys[idx++] = key;
+      }
+    }
+
+    // Make the noise ciphers and queries directly in the slot.
+    NoiseSlot slot = store->Create(range.first, range.second, noise_count);
+    if (!slot.IsValid()) {
+      return false;
+    }
+    Query* queries = slot.Queries();
+    parallel::ParallelFor(noise_count, [&](unsigned, index_t s, index_t e) {
+      std::unique_ptr<OfflineSecret[]> secrets =
+          std::make_unique<OfflineSecret[]>(remaining_parties);
+      std::unique_ptr<incremental_inverse_t[]> inverses =
+          std::make_unique<incremental_inverse_t[]>(remaining_parties);
+      for (index_t i = s; i < e; i++) {
+        queries[i].tag = MakeNoiseSecret(config, party_id, server_id, i,
+                                         secrets.get(), inverses.get());
+        queries[i].tally = sharing::GenerateIncrementalTally(
+            keys[i], inverses.get(), remaining_parties);
+        onion::OnionEncrypt(secrets.get(), party_id + 1, config.party_count,
+                            pkeys, slot.Cipher(i), config.onion_scheme);
+      }
+    });
+    if (!store->Commit(&slot)) {
+      return false;
+    }
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto d = std::chrono::duration_cast<millis>(end_time - start_time).count();
+    std::cout << "Noise: " << noise_count << "; Took " << d << "ms"
+              << std::endl;
+  }
+  return true;
+}
+
+}  // namespace protocol
+}  // namespace DPPIR
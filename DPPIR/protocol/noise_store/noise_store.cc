@@ -0,0 +1,271 @@
+#include "DPPIR/protocol/noise_store/noise_store.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "DPPIR/onion/onion.h"
+#include "DPPIR/random/random.h"
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+// "DPPIRNS1".
+#define NOISE_SLOT_MAGIC 0x31534E5249505044ull
+// Queries start at this offset in the file, ciphers follow.
+#define NOISE_SLOT_HEADER_SIZE 128
+
+namespace DPPIR {
+namespace protocol {
+
+struct NoiseSlot::Header {
+  uint64_t magic;
+  unsigned char fingerprint[NOISE_FINGERPRINT_SIZE];
+  uint64_t party_id;
+  uint64_t server_id;
+  uint64_t noise_start;
+  uint64_t noise_end;
+  uint64_t noise_count;
+  uint64_t cipher_size;
+};
+
+namespace {
+
+size_t SlotSize(index_t noise_count, size_t cipher_size) {
+  return NOISE_SLOT_HEADER_SIZE + noise_count * (sizeof(Query) + cipher_size);
+}
+
+bool EndsWith(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}  // namespace
+
+// NoiseSlot.
+NoiseSlot::NoiseSlot() : path_(), ptr_(nullptr), size_(0) {}
+
+NoiseSlot::NoiseSlot(NoiseSlot&& other)
+    : path_(std::move(other.path_)), ptr_(other.ptr_), size_(other.size_) {
+  other.ptr_ = nullptr;
+  other.size_ = 0;
+}
+
+NoiseSlot& NoiseSlot::operator=(NoiseSlot&& other) {
+  if (this != &other) {
+    this->Unmap();
+    this->path_ = std::move(other.path_);
+    this->ptr_ = other.ptr_;
+    this->size_ = other.size_;
+    other.ptr_ = nullptr;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+NoiseSlot::~NoiseSlot() { this->Unmap(); }
+
+NoiseSlot::Header* NoiseSlot::header() const {
+  return reinterpret_cast<Header*>(this->ptr_);
+}
+
+void NoiseSlot::Unmap() {
+  if (this->ptr_ != nullptr) {
+    munmap(this->ptr_, this->size_);
+    this->ptr_ = nullptr;
+    this->size_ = 0;
+  }
+}
+
+key_t NoiseSlot::NoiseStart() const { return this->header()->noise_start; }
+key_t NoiseSlot::NoiseEnd() const { return this->header()->noise_end; }
+index_t NoiseSlot::NoiseCount() const { return this->header()->noise_count; }
+
+Query* NoiseSlot::Queries() {
+  return reinterpret_cast<Query*>(this->ptr_ + NOISE_SLOT_HEADER_SIZE);
+}
+char* NoiseSlot::Ciphers() {
+  return this->ptr_ + NOISE_SLOT_HEADER_SIZE +
+         this->NoiseCount() * sizeof(Query);
+}
+char* NoiseSlot::Cipher(index_t id) {
+  assert(id < this->NoiseCount());
+  return this->Ciphers() + id * this->header()->cipher_size;
+}
+
+void NoiseSlot::Release() {
+  this->Unmap();
+  if (!this->path_.empty()) {
+    unlink(this->path_.c_str());
+    this->path_.clear();
+  }
+}
+
+// NoiseStore.
+NoiseStore::NoiseStore(const std::string& dir, const config::Config& config,
+                       party_id_t party_id, server_id_t server_id)
+    : dir_(dir),
+      prefix_(),
+      fingerprint_(),
+      party_id_(party_id),
+      server_id_(server_id),
+      cipher_size_(onion::CipherSize(config.party_count - party_id - 1,
+                                     config.onion_scheme)) {
+  // Slots are only compatible with the exact config they were made for.
+  std::string data = config::Serialize(config);
+  crypto_generichash(this->fingerprint_, NOISE_FINGERPRINT_SIZE,
+                     reinterpret_cast<const unsigned char*>(data.c_str()),
+                     data.size(), nullptr, 0);
+  char hex[17];
+  sodium_bin2hex(hex, sizeof(hex), this->fingerprint_, 8);
+  this->prefix_ = std::string("noise_") + hex + "_" +
+                  std::to_string(party_id) + "_" + std::to_string(server_id) +
+                  "_";
+  // Noise material is secret.
+  // On failure, Create() and Take() fail too and parties use fresh noise.
+  if (mkdir(this->dir_.c_str(), 0700) < 0 && errno != EEXIST) {
+    perror("noise store: ");
+  }
+}
+
+NoiseSlot NoiseStore::Create(key_t noise_start, key_t noise_end,
+                             index_t noise_count) {
+  // Unique name.
+  char id[17];
+  uint64_t rand;
+  random::ThreadSampler().Fill(&rand, sizeof(rand));
+  sodium_bin2hex(id, sizeof(id), reinterpret_cast<unsigned char*>(&rand),
+                 sizeof(rand));
+
+  NoiseSlot slot;
+  std::string path = this->dir_ + "/" + this->prefix_ + id + ".tmp";
+  size_t size = SlotSize(noise_count, this->cipher_size_);
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    perror("noise store: ");
+    return slot;
+  }
+  void* ptr = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (ptr == MAP_FAILED) {
+    perror("noise store: ");
+    close(fd);
+    unlink(path.c_str());
+    return slot;
+  }
+  close(fd);
+  slot.path_ = path;
+  slot.ptr_ = static_cast<char*>(ptr);
+  slot.size_ = size;
+
+  static_assert(sizeof(NoiseSlot::Header) <= NOISE_SLOT_HEADER_SIZE);
+  NoiseSlot::Header* header = slot.header();
+  header->magic = NOISE_SLOT_MAGIC;
+  memcpy(header->fingerprint, this->fingerprint_, NOISE_FINGERPRINT_SIZE);
+  header->party_id = this->party_id_;
+  header->server_id = this->server_id_;
+  header->noise_start = noise_start;
+  header->noise_end = noise_end;
+  header->noise_count = noise_count;
+  header->cipher_size = this->cipher_size_;
+  return slot;
+}
+
+bool NoiseStore::Commit(NoiseSlot* slot) {
+  assert(slot->IsValid() && EndsWith(slot->path_, ".tmp"));
+  std::string path =
+      slot->path_.substr(0, slot->path_.size() - 4) + ".slot";
+  if (msync(slot->ptr_, slot->size_, MS_SYNC) < 0 ||
+      rename(slot->path_.c_str(), path.c_str()) < 0) {
+    perror("noise store: ");
+    slot->Release();
+    return false;
+  }
+  slot->Unmap();
+  slot->path_.clear();
+  return true;
+}
+
+NoiseSlot NoiseStore::Take() {
+  NoiseSlot slot;
+  DIR* dir = opendir(this->dir_.c_str());
+  if (dir == nullptr) {
+    return slot;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.compare(0, this->prefix_.size(), this->prefix_) != 0 ||
+        !EndsWith(name, ".slot")) {
+      continue;
+    }
+    // Claim the slot, fails if another process claimed it first.
+    std::string path = this->dir_ + "/" + name;
+    std::string taken = path.substr(0, path.size() - 5) + ".taken";
+    if (rename(path.c_str(), taken.c_str()) < 0) {
+      continue;
+    }
+    slot.path_ = taken;
+
+    int fd = open(taken.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 &&
+        static_cast<size_t>(st.st_size) >= NOISE_SLOT_HEADER_SIZE) {
+      void* ptr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0);
+      if (ptr != MAP_FAILED) {
+        slot.ptr_ = static_cast<char*>(ptr);
+        slot.size_ = st.st_size;
+      }
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+
+    // Validate the header, discard corrupted or mismatching slots.
+    NoiseSlot::Header* header = slot.header();
+    if (slot.IsValid() && header->magic == NOISE_SLOT_MAGIC &&
+        memcmp(header->fingerprint, this->fingerprint_,
+               NOISE_FINGERPRINT_SIZE) == 0 &&
+        header->party_id == this->party_id_ &&
+        header->server_id == this->server_id_ &&
+        header->cipher_size == this->cipher_size_ &&
+        slot.size_ == SlotSize(header->noise_count, this->cipher_size_)) {
+      break;
+    }
+    std::cout << "Discarding invalid noise slot " << name << std::endl;
+    slot.Release();
+  }
+  closedir(dir);
+  return slot;
+}
+
+index_t NoiseStore::Count() const {
+  index_t count = 0;
+  DIR* dir = opendir(this->dir_.c_str());
+  if (dir == nullptr) {
+    return count;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.compare(0, this->prefix_.size(), this->prefix_) == 0 &&
+        EndsWith(name, ".slot")) {
+      count++;
+    }
+  }
+  closedir(dir);
+  return count;
+}
+
+}  // namespace protocol
+}  // namespace DPPIR
@@ -0,0 +1,121 @@
+// On-disk store of precomputed noise material.
+//
+// The noise a party adds only depends on the config and on which (party,
+// server) adds it, not on the batch. The most expensive offline step (making
+// noise secrets and onion encrypting them) can thus be carried out ahead of
+// time, e.g. between batches, by PrecomputeNoise(). Every batch then consumes
+// one slot of ready noise instead.
+// A slot contains the noise ciphers and the matching noise queries. Slots are
+// secret and are used exactly once: Take() claims a slot atomically, and
+// Release() deletes it.
+#ifndef DPPIR_PROTOCOL_NOISE_STORE_NOISE_STORE_H_
+#define DPPIR_PROTOCOL_NOISE_STORE_NOISE_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "DPPIR/config/config.h"
+#include "DPPIR/types/types.h"
+
+// Size of the config fingerprint identifying compatible slots.
+#define NOISE_FINGERPRINT_SIZE 32
+
+namespace DPPIR {
+namespace protocol {
+
+// Tag of noise query id made by (party_id, server_id).
+// Noise tags carry the (party, server) that made them above the range of
+// client tags, so they never collide and do not depend on the batch.
+// TODO(babman): sample the tag uniformly at random.
+inline tag_t NoiseTag(party_id_t party_id, server_id_t server_id,
+                      index_t id) {
+  return (static_cast<tag_t>(party_id + 1) << 56) |
+         (static_cast<tag_t>(server_id) << 40) | id;
+}
+
+// Samples the offline secrets of noise query id made by (party_id, server_id)
+// for all remaining parties into secrets, and writes their inverted
+// incremental shares to inverses. Returns the tag of the noise query.
+tag_t MakeNoiseSecret(const config::Config& config, party_id_t party_id,
+                      server_id_t server_id, index_t id,
+                      OfflineSecret* secrets,
+                      incremental_inverse_t* inverses);
+
+// A memory mapped slot file. Move only.
+class NoiseSlot {
+ public:
+  NoiseSlot();
+  NoiseSlot(NoiseSlot&& other);
+  NoiseSlot& operator=(NoiseSlot&& other);
+  NoiseSlot(const NoiseSlot&) = delete;
+  NoiseSlot& operator=(const NoiseSlot&) = delete;
+  ~NoiseSlot();
+
+  bool IsValid() const { return this->ptr_ != nullptr; }
+
+  // Noise domain and count.
+  key_t NoiseStart() const;
+  key_t NoiseEnd() const;
+  index_t NoiseCount() const;
+
+  // Noise queries (in noise id order), and noise ciphers (consecutive).
+  Query* Queries();
+  char* Ciphers();
+  char* Cipher(index_t id);
+
+  // Deletes a taken slot so it can never be used again.
+  void Release();
+
+ private:
+  friend class NoiseStore;
+  struct Header;
+
+  Header* header() const;
+  void Unmap();
+
+  std::string path_;
+  char* ptr_;
+  size_t size_;
+};
+
+// Directory of slots for a given (config, party, server).
+// Slots of other configs or other parties/servers in the same directory are
+// ignored.
+class NoiseStore {
+ public:
+  NoiseStore(const std::string& dir, const config::Config& config,
+             party_id_t party_id, server_id_t server_id);
+
+  // Creates a new (not yet visible) slot for noise_count queries, or returns
+  // an invalid slot on failure.
+  NoiseSlot Create(key_t noise_start, key_t noise_end, index_t noise_count);
+  // Makes a created slot visible to Take(). On failure, deletes the slot and
+  // returns false.
+  bool Commit(NoiseSlot* slot);
+
+  // Claims a ready slot, or returns an invalid slot if there is none.
+  NoiseSlot Take();
+
+  // Number of ready slots.
+  index_t Count() const;
+
+ private:
+  std::string dir_;
+  // Slot file names start with prefix_.
+  std::string prefix_;
+  unsigned char fingerprint_[NOISE_FINGERPRINT_SIZE];
+  party_id_t party_id_;
+  server_id_t server_id_;
+  size_t cipher_size_;
+};
+
+// Creates slots until store has count ready slots.
+// Returns false if a slot cannot be stored (parties then use fresh noise).
+bool PrecomputeNoise(const config::Config& config, party_id_t party_id,
+                     server_id_t server_id, NoiseStore* store, index_t count);
+
+}  // namespace protocol
+}  // namespace DPPIR
+
+#endif  // DPPIR_PROTOCOL_NOISE_STORE_NOISE_STORE_H_
@@ -0,0 +1,129 @@
+// Tests precomputing noise into a store and consuming it.
+
+#include "DPPIR/protocol/noise_store/noise_store.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DPPIR/config/config.h"
+#include "DPPIR/onion/onion.h"
+#include "DPPIR/sharing/incremental.h"
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+namespace DPPIR {
+namespace protocol {
+
+config::Config DummyConfig(double epsilon) {
+  config::Config config;
+  config.db_size = 100;
+  config.epsilon = epsilon;
+  config.delta = 0.000001;
+  config.party_count = 2;
+  config.server_count = 1;
+  config.sample_noise = true;
+  config.parties = std::vector<config::PartyConfig>(config.party_count);
+  for (config::PartyConfig& party : config.parties) {
+    party.shared_seed = 0;
+    party.servers = std::vector<config::ServerConfig>(1);
+    onion::GenerateKeyPair(&party.onion_pkey, &party.onion_skey);
+  }
+  return config;
+}
+
+// The next party must be able to decrypt the noise ciphers, and use the
+// decrypted secrets to reconstruct the keys of the noise queries.
+bool CheckSlot(const config::Config& config, NoiseSlot* slot) {
+  const config::PartyConfig& next = config.parties.at(1);
+  Query* queries = slot->Queries();
+  key_t previous = slot->NoiseStart();
+  for (index_t id = 0; id < slot->NoiseCount(); id++) {
+    if (queries[id].tag != NoiseTag(0, 0, id)) {
+      std::cout << "Bad noise tag" << std::endl;
+      return false;
+    }
+    onion::OnionLayer layer =
+        onion::OnionDecrypt(slot->Cipher(id), 1, next.onion_pkey,
+                            next.onion_skey, config.onion_scheme);
+    if (layer.Msg().tag != queries[id].tag) {
+      std::cout << "Cipher and query do not match" << std::endl;
+      return false;
+    }
+    // Noise queries are sorted by key.
+    key_t query = sharing::IncrementalReconstruct(queries[id].tally,
+                                                  layer.Msg().share);
+    if (query < previous || query >= slot->NoiseEnd()) {
+      std::cout << "Bad noise query " << query << std::endl;
+      return false;
+    }
+    previous = query;
+  }
+  return true;
+}
+
+bool Test() {
+  char dir[] = "/tmp/dppir.noise_store.XXXXXX";
+  if (mkdtemp(dir) == nullptr) {
+    std::cout << "Cannot create directory" << std::endl;
+    return false;
+  }
+  config::Config config = DummyConfig(1.0);
+  NoiseStore store(dir, config, 0, 0);
+  if (!PrecomputeNoise(config, 0, 0, &store, 2) || store.Count() != 2) {
+    std::cout << "Expected 2 slots" << std::endl;
+    return false;
+  }
+
+  // Slots of other configs and parties/servers are not visible.
+  NoiseStore other_config(dir, DummyConfig(2.0), 0, 0);
+  NoiseStore other_server(dir, config, 0, 1);
+  if (other_config.Count() != 0 || other_config.Take().IsValid() ||
+      other_server.Count() != 0 || other_server.Take().IsValid()) {
+    std::cout << "Slots are visible to other stores" << std::endl;
+    return false;
+  }
+
+  // Every slot is taken exactly once.
+  for (index_t i = 0; i < 2; i++) {
+    NoiseSlot slot = store.Take();
+    if (!slot.IsValid() || store.Count() != 1 - i) {
+      std::cout << "Cannot take slot" << std::endl;
+      return false;
+    }
+    if (!CheckSlot(config, &slot)) {
+      return false;
+    }
+    slot.Release();
+  }
+  if (store.Take().IsValid()) {
+    std::cout << "Slot taken twice" << std::endl;
+    return false;
+  }
+
+  // A store that cannot be written to has no slots.
+  std::string missing = std::string(dir) + "/missing/store";
+  NoiseStore broken(missing, config, 0, 0);
+  if (PrecomputeNoise(config, 0, 0, &broken, 1) || broken.Take().IsValid()) {
+    std::cout << "Broken store has slots" << std::endl;
+    return false;
+  }
+  return rmdir(dir) == 0;
+}
+
+}  // namespace protocol
+}  // namespace DPPIR
+
+int main() {
+  assert(sodium_init() >= 0);
+  if (!DPPIR::protocol::Test()) {
+    std::cout << "Test failed!" << std::endl;
+    return 1;
+  }
+  std::cout << "All tests passed!" << std::endl;
+  return 0;
+}
@@ -10,11 +10,14 @@
 
 #include "DPPIR/config/config.h"
 #include "DPPIR/noise/noise.h"
+#include "DPPIR/parallel/parallel.h"
+#include "DPPIR/protocol/noise_store/noise_store.h"
 #include "DPPIR/shuffle/local_shuffle.h"
 #include "DPPIR/shuffle/parallel_shuffle.h"
 #include "DPPIR/sockets/client_socket.h"
 #include "DPPIR/sockets/parallel_socket.h"
 #include "DPPIR/sockets/server_socket.h"
+#include "DPPIR/sockets/transport.h"
 #include "DPPIR/types/containers.h"
 #include "DPPIR/types/database.h"
 #include "DPPIR/types/state.h"
@@ -28,10 +31,24 @@ class ParallelParty {
   ParallelParty(server_id_t server_id, party_id_t party_id,
                 config::Config&& config, Database&& db);
 
+  // Use noise precomputed in the given store directory (see
+  // PrecomputeNoise()) in the offline stage when available.
+  void SetNoiseStore(const std::string& dir) { this->noise_store_ = dir; }
+  // Compute the local shuffle on the fly instead of storing it (see
+  // shuffle::Feistel), saves 8 bytes per query but takes more time.
+  void SetImplicitShuffle(bool implicit) {
+    this->lshuffler_.SetImplicit(implicit);
+  }
+  // Send batches with MSG_ZEROCOPY where the kernel supports it (see
+  // sockets::Transport::SendDirect()).
+  void SetZeroCopy(bool zerocopy) { this->transport_.SetZeroCopy(zerocopy); }
+
   // Start the protocol.
-  void Start(bool offline, bool online) {
+  // With pipeline, the offline stage receives and decrypts ciphers while
+  // creating noise ciphers, instead of doing these steps one after the other.
+  void Start(bool offline, bool online, bool pipeline = false) {
     if (offline) {
-      this->StartOffline();
+      this->StartOffline(pipeline);
     } else {
       this->SimulateOffline();
     }
@@ -49,6 +66,8 @@ class ParallelParty {
   // Cipher (i.e. message) size for input/output onion ciphers (offline).
   size_t input_cipher_size_;
   size_t output_cipher_size_;
+  // Event loop shared by all sockets.
+  sockets::Transport transport_;
   // Socket from previous party (or client if party_id_ == 0).
   sockets::ServerSocket back_;
   // Socket to next party.
@@ -94,23 +113,31 @@ class ParallelParty {
   // Noise domain.
   key_t noise_start_;
   key_t noise_end_;
+  // Precomputed noise.
+  std::string noise_store_;
+  NoiseSlot noise_slot_;
   // Onion encryption keys.
   std::vector<pkey_t> pkeys_;
+  // Scratch space for handling a chunk of queries at once.
+  std::vector<incremental_share_t> chunk_shares_;
+  std::vector<incremental_tally_t> chunk_tallies_;
 
   // Initialization: these steps should be done offline.
+  bool TakeNoiseSlot();
   void InitializeNoiseSamples();
   void InitializeCounts();
   void InitializeShufflers();
   void InitializeNoiseQueries();
 
   // Offline steps.
-  void CollectCiphers();
+  void InitializeCiphers();
+  void CollectCiphers(parallel::Counter* received);
   void CreateNoiseCiphers();
-  void InstallSecrets();
+  void InstallSecrets(parallel::Counter* received);
   void ShuffleCiphers();
   void SendCiphers();
   void BroadcastSecrets();
-  void StartOffline();
+  void StartOffline(bool pipeline);
   void SimulateOffline();
 
   // Online steps.
@@ -130,10 +157,10 @@ class ParallelParty {
   void FromSibling(server_id_t source, const Response& response);
 
   // Handlers.
-  tag_t SampleTag(index_t id);
-  std::unique_ptr<OfflineSecret[]> MakeNoiseSecret(index_t id);
+  void MakeNoiseSecret(index_t id, OfflineSecret* secrets);
   void MakeNoiseQuery(key_t key, Query* target);
-  void HandleQuery(const Query& input, Query* target);
+  // Handles count received queries in place.
+  void HandleQueries(Query* queries, index_t count);
   void HandleResponse(const tag_t& tag, const Response& input,
                       Response* target);
 
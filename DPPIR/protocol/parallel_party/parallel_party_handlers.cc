@@ -1,4 +1,4 @@
-#include <utility>
+#include <vector>
 
 #include "DPPIR/protocol/parallel_party/parallel_party.h"
 #include "DPPIR/sharing/additive.h"
@@ -7,51 +7,16 @@
 namespace DPPIR {
 namespace protocol {
 
-static int64_t NOISE_OFFSET = -1;
-
-// Randomly sample a tag. Must be from a large enough domain to avoid colisions.
-tag_t ParallelParty::SampleTag(index_t id) {
-  // The below leaks information but is helpful for debugging as it allows us
-  // to determine the source of a message via its tag.
-  if (NOISE_OFFSET == -1) {
-    index_t range = this->noise_end_ - this->noise_start_;
-    index_t noise_per_row = this->noise_count_ / range;
-    index_t total_noise = noise_per_row * this->db_.Size();
-    NOISE_OFFSET = total_noise - (this->noise_start_ * noise_per_row);
-  }
-  // TODO(babman): sample the tag uniformly at random.
-  return this->total_batch_size_ - NOISE_OFFSET + id;
-}
-
-// Samples an offline secret, stores it in state, and returns it for
+// Samples an offline secret, stores it in state, and writes it to secrets for
 // use in the offline protocol.
-std::unique_ptr<OfflineSecret[]> ParallelParty::MakeNoiseSecret(index_t id) {
-  party_id_t remaining_parties = this->party_count_ - this->party_id_ - 1;
-
-  // Sample secret components.
-  tag_t tag = this->SampleTag(id);
-  std::vector<incremental_share_t> incrementals =
-      sharing::PreIncrementalSecretShares(remaining_parties);
-  std::vector<preshare_t> preshares =
-      sharing::GenerateAdditiveSecretShares(remaining_parties + 1);
-
-  // Construct the secret of each party
-  std::unique_ptr<OfflineSecret[]> secrets =
-      std::make_unique<OfflineSecret[]>(remaining_parties);
-  for (party_id_t party_id = 0; party_id < remaining_parties; party_id++) {
-    OfflineSecret& secret = secrets[party_id];
-    secret.tag = tag;
-    secret.next_tag = this->SampleTag(id);
-    secret.share = incrementals.at(party_id);
-    secret.preshare = preshares.at(party_id);
-    tag = secret.next_tag;
-  }
-
+void ParallelParty::MakeNoiseSecret(index_t id, OfflineSecret* secrets) {
+  Span<incremental_inverse_t> inverses =
+      this->noise_state_.IncrementalSlot(id);
+  tag_t tag = protocol::MakeNoiseSecret(this->config_, this->party_id_,
+                                        this->server_id_, id, secrets,
+                                        inverses.data());
   // Store relevant portion in client state.
-  this->noise_state_.AddNoiseSecret(tag, std::move(incrementals));
-
-  // Done!
-  return secrets;
+  this->noise_state_.AddNoiseSecret(id, tag);
 }
 
 // Make a (noise) query targeting given DB key.
@@ -60,19 +25,33 @@ void ParallelParty::MakeNoiseQuery(key_t key, Query* target) {
   this->noise_state_.LoadNext();
   // Query components.
   target->tag = this->noise_state_.GetTag();
-  target->tally = sharing::GenerateIncrementalTally(
-      key, this->noise_state_.GetIncrementalShares());
+  Span<const incremental_inverse_t> inverses =
+      this->noise_state_.GetIncrementalShares();
+  target->tally = sharing::GenerateIncrementalTally(key, inverses.data(),
+                                                    inverses.size());
 }
 
-// Handle an incoming query.
-void ParallelParty::HandleQuery(const Query& input, Query* target) {
-  // Load the offline secret corresponding to received query tag.
-  this->queries_state_.LoadSecret(input.tag);
+// Handle incoming queries (in place).
+void ParallelParty::HandleQueries(Query* queries, index_t count) {
+  this->chunk_shares_.resize(count);
+  this->chunk_tallies_.resize(count);
 
-  // Use the secret to handle the query.
-  target->tag = this->queries_state_.GetNextTag();
-  target->tally = sharing::IncrementalReconstruct(
-      input.tally, this->queries_state_.GetIncremental());
+  // Load the offline secrets corresponding to the received query tags.
+  for (index_t i = 0; i < count; i++) {
+    Query& query = queries[i];
+    this->queries_state_.LoadSecret(query.tag);
+    query.tag = this->queries_state_.GetNextTag();
+    this->chunk_shares_[i] = this->queries_state_.GetIncremental();
+    this->chunk_tallies_[i] = query.tally;
+  }
+
+  // Use the secrets to handle the queries.
+  sharing::IncrementalReconstructBatch(this->chunk_tallies_.data(),
+                                       this->chunk_shares_.data(), count,
+                                       this->chunk_tallies_.data());
+  for (index_t i = 0; i < count; i++) {
+    queries[i].tally = this->chunk_tallies_[i];
+  }
 }
 
 // Handle a response received from the next party.
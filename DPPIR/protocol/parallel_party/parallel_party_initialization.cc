@@ -1,6 +1,7 @@
 #include <cassert>
 #include <iostream>
 #include <utility>
+#include <vector>
 
 #include "DPPIR/onion/onion.h"
 #include "DPPIR/protocol/parallel_party/parallel_party.h"
@@ -16,12 +17,15 @@ ParallelParty::ParallelParty(party_id_t party_id, server_id_t server_id,
       party_count_(config.party_count),
       server_count_(config.server_count),
       // Offline onion cipher sizes.
-      input_cipher_size_(onion::CipherSize(party_count_ - party_id)),
-      output_cipher_size_(onion::CipherSize(party_count_ - party_id - 1)),
+      input_cipher_size_(
+          onion::CipherSize(party_count_ - party_id, config.onion_scheme)),
+      output_cipher_size_(
+          onion::CipherSize(party_count_ - party_id - 1, config.onion_scheme)),
       // Sockets.
-      back_(input_cipher_size_),
-      next_(output_cipher_size_),
-      siblings_(server_id_, server_count_, output_cipher_size_),
+      transport_(),
+      back_(input_cipher_size_, &transport_),
+      next_(output_cipher_size_, &transport_),
+      siblings_(server_id_, server_count_, output_cipher_size_, &transport_),
       // Parallel count maps.
       at_sibling_counts_(server_count_, server_count_ + 1, 0),
       total_batch_size_(0),
@@ -35,7 +39,8 @@ ParallelParty::ParallelParty(party_id_t party_id, server_id_t server_id,
       // Database.
       db_(std::move(db)),
       // Shuffler.
-      pshuffler_(server_id_, server_count_, party_config_.shared_seed),
+      pshuffler_(server_id_, server_count_, party_config_.shared_seed,
+                 config::ServerWeights(party_config_)),
       lshuffler_(server_config_.local_seed),
       // Counts.
       noise_count_(0),
@@ -54,11 +59,18 @@ ParallelParty::ParallelParty(party_id_t party_id, server_id_t server_id,
       queries_state_(),
       noise_state_(),
       // Noise distribution.
-      distribution_(config_.epsilon, config_.delta),
+      distribution_(config_.epsilon, config_.delta, config_.sample_noise,
+                    config_.noise_mechanism),
       noise_start_(0),
       noise_end_(0),
+      // Precomputed noise.
+      noise_store_(),
+      noise_slot_(),
       // Onion encryption keys.
-      pkeys_() {
+      pkeys_(),
+      // Scratch space.
+      chunk_shares_(),
+      chunk_tallies_() {
   assert(this->party_count_ >= 2 && this->party_id_ < this->party_count_ - 1);
   assert(this->server_count_ > 1 && this->server_id_ < this->server_count_);
   // Primary keys.
@@ -81,20 +93,45 @@ ParallelParty::ParallelParty(party_id_t party_id, server_id_t server_id,
 
 // Sample the noise (but do not make any noise queries yet).
 // Also computes the total noise queries to be added by this server.
+// Claims a slot of precomputed noise and uses its noise domain and count.
+bool ParallelParty::TakeNoiseSlot() {
+  if (this->noise_store_.empty()) {
+    return false;
+  }
+  NoiseStore store(this->noise_store_, this->config_, this->party_id_,
+                   this->server_id_);
+  this->noise_slot_ = store.Take();
+  if (!this->noise_slot_.IsValid()) {
+    std::cout << "No precomputed noise available" << std::endl;
+    return false;
+  }
+  this->noise_start_ = this->noise_slot_.NoiseStart();
+  this->noise_end_ = this->noise_slot_.NoiseEnd();
+  this->noise_count_ = this->noise_slot_.NoiseCount();
+  std::cout << "Using precomputed noise" << std::endl;
+  return true;
+}
+
 void ParallelParty::InitializeNoiseSamples() {
   this->noise_count_ = 0;
   // Compute the noise domain.
   auto pair =
-      noise::FindRange(this->server_id_, this->server_count_, this->db_.Size());
+      noise::FindRange(this->server_id_, this->server_count_, this->db_.Size(),
+                       config::ServerWeights(this->party_config_));
   this->noise_start_ = pair.first;
   this->noise_end_ = pair.second;
   // Sample the noise per element in domain.
   key_t size = this->noise_end_ - this->noise_start_;
   this->noise_.Initialize(size);
-  for (key_t i = 0; i < size; i++) {
-    sample_t sample = this->distribution_.Sample();
-    this->noise_.PushBack(sample);
-    this->noise_count_ += sample;
+  std::vector<index_t> counts(parallel::ThreadCount(), 0);
+  parallel::ParallelFor(size, [&, this](unsigned tid, index_t s, index_t e) {
+    this->distribution_.SampleBatch(this->noise_.begin() + s, e - s);
+    for (index_t i = s; i < e; i++) {
+      counts[tid] += this->noise_[i];
+    }
+  });
+  for (index_t count : counts) {
+    this->noise_count_ += count;
   }
 }
 
@@ -121,12 +158,13 @@ void ParallelParty::InitializeCounts() {
   }
 
   // We can compute final count after shuffling sent out from this server, since
-  // shuffling is guaranteed to produce uniform load for every sibling.
-  this->shuffled_count_ = this->total_batch_size_ / this->server_count_;
-  if (this->server_id_ == this->server_count_ - 1) {
-    this->shuffled_count_ =
-        this->total_batch_size_ - (this->shuffled_count_ * this->server_id_);
-  }
+  // shuffling is guaranteed to give every sibling a load proportional to its
+  // weight.
+  auto slice =
+      WeightedRange(this->server_id_, this->server_count_,
+                    config::ServerWeights(this->party_config_),
+                    this->total_batch_size_);
+  this->shuffled_count_ = slice.second - slice.first;
 
   // Send count to next party so they can start initialization as well.
   this->next_.SendCount(this->shuffled_count_);
@@ -172,6 +210,17 @@ void ParallelParty::InitializeShufflers() {
 
 // Make noise queries according to the samples.
 void ParallelParty::InitializeNoiseQueries() {
+  // Precomputed noise queries are ready.
+  if (this->noise_slot_.IsValid()) {
+    Query* queries = this->noise_slot_.Queries();
+    for (index_t idx = 0; idx < this->noise_count_; idx++) {
+      this->in_queries_[idx] = queries[idx];
+    }
+    // Noise material must never be used twice.
+    this->noise_slot_.Release();
+    return;
+  }
+
   index_t idx = 0;
   for (key_t key = this->noise_start_; key < this->noise_end_; key++) {
     sample_t sample = this->noise_[key - this->noise_start_];
@@ -1,8 +1,13 @@
 // NOLINTNEXTLINE
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+// NOLINTNEXTLINE
+#include <thread>
 
 #include "DPPIR/onion/onion.h"
+#include "DPPIR/parallel/parallel.h"
 #include "DPPIR/protocol/parallel_party/parallel_party.h"
 
 namespace DPPIR {
@@ -10,41 +15,71 @@ namespace protocol {
 
 using millis = std::chrono::milliseconds;
 
-void ParallelParty::CollectCiphers() {
+void ParallelParty::InitializeCiphers() {
+  this->in_ciphers_.Initialize(this->noise_count_, this->input_count_);
+  // Noise ciphers take up the first short slots, decrypted ciphers follow.
+  this->in_ciphers_.AdvanceShort(this->noise_count_);
+}
+
+void ParallelParty::CollectCiphers(parallel::Counter* received) {
   // Listen to all incoming offline messages.
   std::cout << "Listening for offline ciphers..." << std::endl;
-  size_t count = this->input_count_;
-  while (count > 0) {
-    CipherLogicalBuffer& buffer = this->back_.ReadCiphers(count);
-    for (char* cipher : buffer) {
-      if (--count % PROGRESS_RATE == 0) {
-        std::cout << "Progress " << count << std::endl;
-      }
-      this->in_ciphers_.PushLong(cipher);
-    }
+  index_t idx = 0;
+  while (idx < this->input_count_) {
+    CipherLogicalBuffer& buffer =
+        this->back_.ReadCiphers(this->input_count_ - idx);
+    index_t start = idx;
+    memcpy(this->in_ciphers_.LongSlot(idx), buffer[0], buffer.BufferSize());
+    idx += buffer.Size();
     buffer.Clear();
+    // Ciphers can be processed (possibly concurrently) from now on.
+    received->Add(idx - start);
+    if (idx / PROGRESS_RATE > start / PROGRESS_RATE) {
+      std::cout << "Received " << idx << "/" << this->input_count_
+                << std::endl;
+    }
   }
 }
 
 void ParallelParty::CreateNoiseCiphers() {
-  this->in_ciphers_.Initialize(this->noise_count_, this->input_count_);
+  if (this->noise_slot_.IsValid()) {
+    std::cout << "Copying precomputed noise ciphers..." << std::endl;
+    for (index_t i = 0; i < this->noise_count_; i++) {
+      this->in_ciphers_.SetShort(i, this->noise_slot_.Cipher(i));
+    }
+    return;
+  }
 
   // Make offline secrets for noise queries.
   std::cout << "Creating secrets and ciphers for noise queries..." << std::endl;
 
   auto start_time = std::chrono::steady_clock::now();
-  for (index_t i = 0; i < this->noise_count_; i++) {
-    if ((i + 1) % PROGRESS_RATE == 0) {
-      std::cout << "Progress " << (i + 1) << " / " << this->noise_count_
-                << std::endl;
+  party_id_t remaining_parties = this->party_count_ - this->party_id_ - 1;
+  for (index_t start = 0; start < this->noise_count_; start += ENCRYPT_WINDOW) {
+    index_t count = this->noise_count_ - start;
+    if (count > ENCRYPT_WINDOW) {
+      count = ENCRYPT_WINDOW;
     }
-    // Sample secrets.
-    std::unique_ptr<OfflineSecret[]> secrets = this->MakeNoiseSecret(i);
+    // Every thread writes its secrets and ciphers to disjoint slots.
+    parallel::ParallelFor(count, [&, this](unsigned, index_t s, index_t e) {
+      std::unique_ptr<OfflineSecret[]> secrets =
+          std::make_unique<OfflineSecret[]>(remaining_parties);
+      for (index_t i = s; i < e; i++) {
+        // Sample secrets.
+        this->MakeNoiseSecret(start + i, secrets.get());
+
+        // Onion encrypt secrets directly into their (reserved) slot.
+        onion::OnionEncrypt(secrets.get(), this->party_id_ + 1,
+                            this->party_count_, this->pkeys_,
+                            this->in_ciphers_.GetShort(start + i),
+                            this->config_.onion_scheme);
+      }
+    });
 
-    // Onion encrypt secrets.
-    std::unique_ptr<char[]> cipher = onion::OnionEncrypt(
-        secrets.get(), this->party_id_ + 1, this->party_count_, this->pkeys_);
-    this->in_ciphers_.PushShort(cipher.get());
+    if ((start + count) / PROGRESS_RATE > start / PROGRESS_RATE) {
+      std::cout << "Progress " << (start + count) << " / "
+                << this->noise_count_ << std::endl;
+    }
   }
 
   auto end_time = std::chrono::steady_clock::now();
@@ -52,28 +87,47 @@ void ParallelParty::CreateNoiseCiphers() {
   std::cout << "Took " << d << "ms" << std::endl;
 }
 
-void ParallelParty::InstallSecrets() {
+void ParallelParty::InstallSecrets(parallel::Counter* received) {
   std::cout << "Decrypting offline ciphers..." << std::endl;
 
   auto start_time = std::chrono::steady_clock::now();
+  party_id_t layers = this->party_count_ - this->party_id_;
+  std::unique_ptr<OfflineSecret[]> secrets =
+      std::make_unique<OfflineSecret[]>(DECRYPT_WINDOW);
   index_t counter = 0;
-  while (this->in_ciphers_.HasLong()) {
-    if (++counter % PROGRESS_RATE == 0) {
-      std::cout << "Progress " << counter << "/" << this->input_count_
-                << std::endl;
+  while (counter < this->input_count_) {
+    // Wait until there are ciphers we have not decrypted yet.
+    if (!this->in_ciphers_.HasLong()) {
+      this->in_ciphers_.SetLongCount(received->WaitForMore(counter));
     }
 
-    // Decrypt cipher.
-    char* cipher = this->in_ciphers_.PopLong();
-    onion::OnionLayer layer = onion::OnionDecrypt(
-        cipher, this->party_count_ - this->party_id_,
-        this->party_config_.onion_pkey, this->party_config_.onion_skey);
-
-    // Install secret.
-    this->queries_state_.Store(layer.Msg());
+    // Decrypt as many ciphers as we safely can in parallel.
+    index_t count = this->in_ciphers_.SafeLongCount();
+    if (count > DECRYPT_WINDOW) {
+      count = DECRYPT_WINDOW;
+    }
+    parallel::ParallelFor(count, [&, this](unsigned, index_t s, index_t e) {
+      // Save next cipher layer to send directly into the batch.
+      char* ciphers = this->in_ciphers_.GetLong(s);
+      char* next_layers = this->in_ciphers_.GetNextShort(s);
+      onion::OnionDecryptBatch(ciphers, e - s, layers,
+                               this->party_config_.onion_pkey,
+                               this->party_config_.onion_skey,
+                               secrets.get() + s, next_layers,
+                               this->config_.onion_scheme);
+    });
+    this->in_ciphers_.AdvanceLong(count);
+
+    // Install secrets.
+    for (index_t i = 0; i < count; i++) {
+      this->queries_state_.Store(secrets[i]);
+    }
 
-    // Save next cipher layer to send.
-    this->in_ciphers_.PushShort(layer.NextLayer());
+    if ((counter + count) / PROGRESS_RATE > counter / PROGRESS_RATE) {
+      std::cout << "Progress " << (counter + count) << "/"
+                << this->input_count_ << std::endl;
+    }
+    counter += count;
   }
 
   auto end_time = std::chrono::steady_clock::now();
@@ -116,11 +170,10 @@ void ParallelParty::BroadcastSecrets() {
   size_t poll_rate = POLL_RATE / sizeof(OfflineSecret);
   this->SendAndPoll<OfflineSecret, SecretPair, PartyState>(
       &copy, poll_rate, copy.size(), total_count, from_counts,
-      std::function<void(const SecretPair&)>([this](const SecretPair& s) {
-        this->siblings_.BroadcastSecret({s.first, s.second.next_tag,
-                                         s.second.incremental,
-                                         s.second.preshare});
-      }),
+      std::function<void(const SecretPair&)>(
+          [this, &copy](const SecretPair& s) {
+            this->siblings_.BroadcastSecret(copy.Export(s));
+          }),
       std::function<index_t(server_id_t, index_t)>(
           [this](server_id_t source, index_t remaining) {
             LogicalBuffer<OfflineSecret>& buffer =
@@ -135,10 +188,22 @@ void ParallelParty::BroadcastSecrets() {
           }));
 }
 
-void ParallelParty::StartOffline() {
-  // Initialization.
-  this->InitializeNoiseSamples();
+void ParallelParty::StartOffline(bool pipeline) {
+  // Initialization: use precomputed noise if there is any.
+  bool precomputed = this->TakeNoiseSlot();
+  if (!precomputed) {
+    this->InitializeNoiseSamples();
+  }
+
+  // Precompute the ephemeral keys of our noise ciphers while waiting for the
+  // counts from the previous party.
+  index_t fresh_noise = precomputed ? 0 : this->noise_count_;
+  onion::StartKeyPool(
+      static_cast<size_t>(fresh_noise) *
+          (this->party_count_ - this->party_id_ - 1),
+      parallel::ThreadCount());
   this->InitializeCounts();
+  onion::StopKeyPool();
 
   // The parties are initialized; start timing.
   // State initialization and noise cipher creation can be carried out after
@@ -148,36 +213,67 @@ void ParallelParty::StartOffline() {
   auto start_time = std::chrono::steady_clock::now();
 
   // Initialize the offline states.
-  this->queries_state_.Initialize(false);
-  this->noise_state_.Initialize(this->party_count_ - this->party_id_ - 1,
-                                this->noise_count_, true, false);
-
-  // Do the offline protocol.
-  this->CreateNoiseCiphers();
-
-  // Wait until the next server and siblings have initialized.
-  this->next_.WaitForReady();
-  this->siblings_.BroadcastReady();
-  this->siblings_.WaitForReady();
-  this->back_.SendReady();
-
-  // Stop timing while collecting ciphers from client.
-  auto end_time = std::chrono::steady_clock::now();
-  auto d = std::chrono::duration_cast<millis>(end_time - start_time).count();
-
-  // Collect offline messages from previous party or client.
-  this->CollectCiphers();
-
-  // Wait for siblings.
-  this->siblings_.BroadcastReady();
-  this->siblings_.WaitForReady();
-
-  // Batch has been received completely; continue timing.
-  start_time = std::chrono::steady_clock::now();
+  this->queries_state_.Initialize(false,
+                                  this->config_.onion_scheme.seeded);
+  if (!precomputed) {
+    this->noise_state_.Initialize(this->party_count_ - this->party_id_ - 1,
+                                  this->noise_count_, true, false);
+  }
 
-  // Initialize the (offline) shuffler.
-  this->InitializeShufflers();
-  this->InstallSecrets();
+  // Cipher storage: noise ciphers first, then ciphers from previous party.
+  this->InitializeCiphers();
+  parallel::Counter received;
+
+  millis::rep d = 0;
+  if (pipeline) {
+    // Let the previous party start sending right away, and decrypt its
+    // ciphers as they arrive while creating the noise ciphers.
+    // Waiting for ciphers overlaps with work, so it is timed.
+    this->next_.WaitForReady();
+    this->siblings_.BroadcastReady();
+    this->siblings_.WaitForReady();
+    this->back_.SendReady();
+    std::thread receiver(&ParallelParty::CollectCiphers, this, &received);
+    std::thread noise(&ParallelParty::CreateNoiseCiphers, this);
+    this->InstallSecrets(&received);
+    receiver.join();
+    noise.join();
+
+    // Wait for siblings.
+    this->siblings_.BroadcastReady();
+    this->siblings_.WaitForReady();
+
+    // Initialize the (offline) shuffler, in the same order with respect to
+    // siblings as without pipelining.
+    this->InitializeShufflers();
+  } else {
+    // Do the offline protocol.
+    this->CreateNoiseCiphers();
+
+    // Wait until the next server and siblings have initialized.
+    this->next_.WaitForReady();
+    this->siblings_.BroadcastReady();
+    this->siblings_.WaitForReady();
+    this->back_.SendReady();
+
+    // Stop timing while collecting ciphers from client.
+    auto end_time = std::chrono::steady_clock::now();
+    d = std::chrono::duration_cast<millis>(end_time - start_time).count();
+
+    // Collect offline messages from previous party or client.
+    this->CollectCiphers(&received);
+
+    // Wait for siblings.
+    this->siblings_.BroadcastReady();
+    this->siblings_.WaitForReady();
+
+    // Batch has been received completely; continue timing.
+    start_time = std::chrono::steady_clock::now();
+
+    // Initialize the (offline) shuffler.
+    this->InitializeShufflers();
+    this->InstallSecrets(&received);
+  }
   this->ShuffleCiphers();
   this->SendCiphers();
   this->BroadcastSecrets();  // Each sibling server must have ALL secrets.
@@ -206,7 +302,7 @@ void ParallelParty::StartOffline() {
   this->back_.SendReady();
 
   // Offline stage is done!
-  end_time = std::chrono::steady_clock::now();
+  auto end_time = std::chrono::steady_clock::now();
   d += std::chrono::duration_cast<millis>(end_time - start_time).count();
   std::cout << "Offline time: " << d << "ms" << std::endl;
 }
@@ -224,7 +320,8 @@ void ParallelParty::SimulateOffline() {
   this->InitializeShufflers();
 
   // Simulate the offline state.
-  this->queries_state_.Initialize(true);
+  this->queries_state_.Initialize(true,
+                                  this->config_.onion_scheme.seeded);
   this->noise_state_.Initialize(this->party_count_ - this->party_id_ - 1,
                                 this->noise_count_, true, true);
 
@@ -19,12 +19,14 @@ void ParallelParty::CollectQueries() {
   while (read < this->in_queries_.Capacity()) {
     size_t remaining = this->in_queries_.Capacity() - read;
     LogicalBuffer<Query>& buffer = this->back_.ReadQueries(remaining);
+    // Store tags for response handling.
     for (Query& in_query : buffer) {
-      // Store tag for response handling.
       this->in_tags_.PushBack(in_query.tag);
-      Query& out_query = this->in_queries_[read++];
-      // Handle query.
-      this->HandleQuery(in_query, &out_query);
+    }
+    // Handle the whole chunk.
+    this->HandleQueries(buffer.begin(), buffer.Size());
+    for (Query& query : buffer) {
+      this->in_queries_[read++] = query;
     }
     buffer.Clear();
   }
@@ -32,10 +34,8 @@ void ParallelParty::CollectQueries() {
 
 void ParallelParty::SendQueries() {
   std::cout << "Sending queries..." << std::endl;
-  for (Query& query : this->out_queries_) {
-    this->next_.SendQuery(query);
-  }
-  this->next_.FlushQueries();
+  this->next_.SendQueries(this->out_queries_.begin(),
+                         this->out_queries_.Capacity());
   this->out_queries_.Free();
 }
 
@@ -68,10 +68,8 @@ void ParallelParty::CollectResponses() {
 
 void ParallelParty::SendResponses() {
   std::cout << "Sending responses..." << std::endl;
-  for (Response& response : this->out_responses_) {
-    this->back_.SendResponse(response);
-  }
-  this->back_.FlushResponses();
+  this->back_.SendResponses(this->out_responses_.begin(),
+                            this->out_responses_.Capacity());
   this->out_responses_.Free();
 }
 
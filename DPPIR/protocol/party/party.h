@@ -8,9 +8,13 @@
 
 #include "DPPIR/config/config.h"
 #include "DPPIR/noise/noise.h"
+#include "DPPIR/parallel/parallel.h"
+#include "DPPIR/protocol/noise_store/noise_store.h"
 #include "DPPIR/shuffle/local_shuffle.h"
+#include "DPPIR/shuffle/permute.h"
 #include "DPPIR/sockets/client_socket.h"
 #include "DPPIR/sockets/server_socket.h"
+#include "DPPIR/sockets/transport.h"
 #include "DPPIR/types/containers.h"
 #include "DPPIR/types/database.h"
 #include "DPPIR/types/state.h"
@@ -24,10 +28,27 @@ class Party {
   Party(server_id_t server_id, party_id_t party_id, config::Config&& config,
         Database&& db);
 
+  // Use noise precomputed in the given store directory (see
+  // PrecomputeNoise()) in the offline stage when available.
+  void SetNoiseStore(const std::string& dir) { this->noise_store_ = dir; }
+  // Shuffle queries and deshuffle responses in cache sized blocks (see
+  // shuffle::Permuter), faster for large batches but uses more memory.
+  void SetBlockedShuffle(bool blocked) { this->blocked_shuffle_ = blocked; }
+  // Compute the local shuffle on the fly instead of storing it (see
+  // shuffle::Feistel), saves 8 bytes per query but takes more time.
+  void SetImplicitShuffle(bool implicit) {
+    this->lshuffler_.SetImplicit(implicit);
+  }
+  // Send batches with MSG_ZEROCOPY where the kernel supports it (see
+  // sockets::Transport::SendDirect()).
+  void SetZeroCopy(bool zerocopy) { this->transport_.SetZeroCopy(zerocopy); }
+
   // Start the protocol.
-  void Start(bool offline, bool online) {
+  // With pipeline, the offline stage receives and decrypts ciphers while
+  // creating noise ciphers, instead of doing these steps one after the other.
+  void Start(bool offline, bool online, bool pipeline = false) {
     if (offline) {
-      this->StartOffline();
+      this->StartOffline(pipeline);
     } else {
       this->SimulateOffline();
     }
@@ -42,6 +63,8 @@ class Party {
   server_id_t server_id_;
   party_id_t party_count_;
   server_id_t server_count_;
+  // Event loop shared by all sockets.
+  sockets::Transport transport_;
   // Socket from previous party (or client if party_id_ == 0).
   sockets::ServerSocket back_;
   // Socket to next party.
@@ -54,6 +77,9 @@ class Party {
   Database db_;
   // Shufflers.
   shuffle::LocalShuffler lshuffler_;  // Shuffler within this server.
+  bool blocked_shuffle_;
+  shuffle::Permuter<Query> query_permuter_;
+  shuffle::Permuter<Response> response_permuter_;
   // Counts.
   index_t noise_count_;
   index_t input_count_;
@@ -72,22 +98,32 @@ class Party {
   // Noise domain.
   key_t noise_start_;
   key_t noise_end_;
+  // Precomputed noise.
+  std::string noise_store_;
+  NoiseSlot noise_slot_;
   // Onion encryption keys.
   std::vector<pkey_t> pkeys_;
+  // Scratch space for handling a chunk of queries at once.
+  std::vector<incremental_share_t> chunk_shares_;
+  std::vector<incremental_tally_t> chunk_tallies_;
+  std::vector<index_t> chunk_targets_;
+  std::vector<preshare_t> chunk_preshares_;
 
   // Protocol steps.
   // Initialization: these steps should be done offline.
+  bool TakeNoiseSlot();
   void InitializeNoiseSamples();
   void InitializeCounts();
   void InitializeShuffler();
   void InitializeNoiseQueries();
 
   // Offline steps.
-  void CollectCiphers();
+  void InitializeCiphers();
+  void CollectCiphers(parallel::Counter* received);
   void CreateNoiseCiphers();
-  void InstallSecrets();
+  void InstallSecrets(parallel::Counter* received);
   void SendCiphers();
-  void StartOffline();
+  void StartOffline(bool pipeline);
   void SimulateOffline();
 
   // Online steps.
@@ -100,12 +136,14 @@ class Party {
   void StartOnline();
 
   // Handlers.
-  tag_t SampleTag(index_t id);
-  std::unique_ptr<OfflineSecret[]> MakeNoiseSecret(index_t id);
+  void MakeNoiseSecret(index_t id, OfflineSecret* secrets);
   void MakeNoiseQuery(key_t key, Query* target);
-  void HandleQuery(const Query& input, Query* target);
-  void HandleResponse(const tag_t& tag, const Response& input,
-                      Response* target);
+  // Handles count received queries in place.
+  void HandleQueries(Query* queries, index_t count);
+  // Handles count received responses in place, targets are their deshuffled
+  // indices (responses to our noise queries are left as is).
+  void HandleResponses(Response* responses, const index_t* targets,
+                       index_t count);
 };
 
 }  // namespace protocol
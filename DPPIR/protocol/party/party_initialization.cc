@@ -1,6 +1,7 @@
 #include <cassert>
 #include <iostream>
 #include <utility>
+#include <vector>
 
 #include "DPPIR/onion/onion.h"
 #include "DPPIR/protocol/party/party.h"
@@ -16,8 +17,12 @@ Party::Party(party_id_t party_id, server_id_t server_id,
       party_count_(config.party_count),
       server_count_(config.server_count),
       // Sockets.
-      back_(onion::CipherSize(party_count_ - party_id)),
-      next_(onion::CipherSize(party_count_ - party_id - 1)),
+      transport_(),
+      back_(onion::CipherSize(party_count_ - party_id, config.onion_scheme),
+            &transport_),
+      next_(onion::CipherSize(party_count_ - party_id - 1,
+                              config.onion_scheme),
+            &transport_),
       // Configuration
       config_(std::move(config)),
       party_config_(config_.parties.at(party_id_)),
@@ -26,14 +31,18 @@ Party::Party(party_id_t party_id, server_id_t server_id,
       db_(std::move(db)),
       // Shuffler.
       lshuffler_(server_config_.local_seed),
+      blocked_shuffle_(false),
+      query_permuter_(),
+      response_permuter_(),
       // Counts.
       noise_count_(0),
       input_count_(0),
       shuffled_count_(0),
       // Batches.
       noise_(),
-      ciphers_(onion::CipherSize(party_count_ - party_id - 1),
-               onion::CipherSize(party_count_ - party_id)),
+      ciphers_(
+          onion::CipherSize(party_count_ - party_id - 1, config_.onion_scheme),
+          onion::CipherSize(party_count_ - party_id, config_.onion_scheme)),
       tags_(),
       queries_(),
       responses_(),
@@ -41,11 +50,20 @@ Party::Party(party_id_t party_id, server_id_t server_id,
       queries_state_(),
       noise_state_(),
       // Noise distribution.
-      distribution_(config_.epsilon, config_.delta),
+      distribution_(config_.epsilon, config_.delta, config_.sample_noise,
+                    config_.noise_mechanism),
       noise_start_(0),
       noise_end_(0),
+      // Precomputed noise.
+      noise_store_(),
+      noise_slot_(),
       // Onion encryption keys.
-      pkeys_() {
+      pkeys_(),
+      // Scratch space.
+      chunk_shares_(),
+      chunk_tallies_(),
+      chunk_targets_(),
+      chunk_preshares_() {
   assert(this->party_count_ >= 2 && this->party_id_ < this->party_count_ - 1);
   assert(this->server_count_ == 1);
   // Primary keys.
@@ -59,20 +77,45 @@ Party::Party(party_id_t party_id, server_id_t server_id,
   this->next_.Initialize(nextserver.ip, nextserver.port);
 }
 
+// Claims a slot of precomputed noise and uses its noise domain and count.
+bool Party::TakeNoiseSlot() {
+  if (this->noise_store_.empty()) {
+    return false;
+  }
+  NoiseStore store(this->noise_store_, this->config_, this->party_id_,
+                   this->server_id_);
+  this->noise_slot_ = store.Take();
+  if (!this->noise_slot_.IsValid()) {
+    std::cout << "No precomputed noise available" << std::endl;
+    return false;
+  }
+  this->noise_start_ = this->noise_slot_.NoiseStart();
+  this->noise_end_ = this->noise_slot_.NoiseEnd();
+  this->noise_count_ = this->noise_slot_.NoiseCount();
+  std::cout << "Using precomputed noise" << std::endl;
+  return true;
+}
+
 void Party::InitializeNoiseSamples() {
   this->noise_count_ = 0;
   // Compute the noise domain.
   auto pair =
-      noise::FindRange(this->server_id_, this->server_count_, this->db_.Size());
+      noise::FindRange(this->server_id_, this->server_count_, this->db_.Size(),
+                       config::ServerWeights(this->party_config_));
   this->noise_start_ = pair.first;
   this->noise_end_ = pair.second;
   // Sample the noise per element in domain.
   key_t size = this->noise_end_ - this->noise_start_;
   this->noise_.Initialize(size);
-  for (key_t i = 0; i < size; i++) {
-    sample_t sample = this->distribution_.Sample();
-    this->noise_.PushBack(sample);
-    this->noise_count_ += sample;
+  std::vector<index_t> counts(parallel::ThreadCount(), 0);
+  parallel::ParallelFor(size, [&, this](unsigned tid, index_t s, index_t e) {
+    this->distribution_.SampleBatch(this->noise_.begin() + s, e - s);
+    for (index_t i = s; i < e; i++) {
+      counts[tid] += this->noise_[i];
+    }
+  });
+  for (index_t count : counts) {
+    this->noise_count_ += count;
   }
 }
 
@@ -95,6 +138,17 @@ void Party::InitializeShuffler() {
 }
 
 void Party::InitializeNoiseQueries() {
+  // Precomputed noise queries are ready.
+  if (this->noise_slot_.IsValid()) {
+    Query* queries = this->noise_slot_.Queries();
+    for (index_t idx = 0; idx < this->noise_count_; idx++) {
+      this->queries_[this->lshuffler_.Shuffle(idx)] = queries[idx];
+    }
+    // Noise material must never be used twice.
+    this->noise_slot_.Release();
+    return;
+  }
+
   index_t idx = 0;
   for (key_t key = this->noise_start_; key < this->noise_end_; key++) {
     sample_t sample = this->noise_[key - this->noise_start_];
@@ -1,50 +1,89 @@
+#include <sys/uio.h>
+
 // NOLINTNEXTLINE
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+// NOLINTNEXTLINE
+#include <thread>
+#include <vector>
 
 #include "DPPIR/onion/onion.h"
+#include "DPPIR/parallel/parallel.h"
 #include "DPPIR/protocol/party/party.h"
+#include "DPPIR/sockets/consts.h"
 
 namespace DPPIR {
 namespace protocol {
 
 using millis = std::chrono::milliseconds;
 
-void Party::CollectCiphers() {
+void Party::InitializeCiphers() {
+  this->ciphers_.Initialize(this->noise_count_, this->input_count_);
+  // Noise ciphers take up the first short slots, decrypted ciphers follow.
+  this->ciphers_.AdvanceShort(this->noise_count_);
+}
+
+void Party::CollectCiphers(parallel::Counter* received) {
   // Listen to all incoming offline messages.
   std::cout << "Listening for offline ciphers..." << std::endl;
-  index_t count = this->input_count_;
-  while (count > 0) {
-    CipherLogicalBuffer& buffer = this->back_.ReadCiphers(count);
-    for (char* cipher : buffer) {
-      if (--count % PROGRESS_RATE == 0) {
-        std::cout << "Progress " << count << std::endl;
-      }
-      this->ciphers_.PushLong(cipher);
-    }
+  index_t idx = 0;
+  while (idx < this->input_count_) {
+    CipherLogicalBuffer& buffer =
+        this->back_.ReadCiphers(this->input_count_ - idx);
+    index_t start = idx;
+    memcpy(this->ciphers_.LongSlot(idx), buffer[0], buffer.BufferSize());
+    idx += buffer.Size();
     buffer.Clear();
+    // Ciphers can be processed (possibly concurrently) from now on.
+    received->Add(idx - start);
+    if (idx / PROGRESS_RATE > start / PROGRESS_RATE) {
+      std::cout << "Received " << idx << "/" << this->input_count_
+                << std::endl;
+    }
   }
 }
 
 void Party::CreateNoiseCiphers() {
-  this->ciphers_.Initialize(this->noise_count_, this->input_count_);
+  if (this->noise_slot_.IsValid()) {
+    std::cout << "Copying precomputed noise ciphers..." << std::endl;
+    for (index_t i = 0; i < this->noise_count_; i++) {
+      this->ciphers_.SetShort(i, this->noise_slot_.Cipher(i));
+    }
+    return;
+  }
 
   // Make offline secrets for noise queries.
   std::cout << "Creating secrets and ciphers for noise queries..." << std::endl;
 
   auto start_time = std::chrono::steady_clock::now();
-  for (index_t i = 0; i < this->noise_count_; i++) {
-    if ((i + 1) % PROGRESS_RATE == 0) {
-      std::cout << "Progress " << (i + 1) << "/" << this->noise_count_
-                << std::endl;
+  party_id_t remaining_parties = this->party_count_ - this->party_id_ - 1;
+  for (index_t start = 0; start < this->noise_count_; start += ENCRYPT_WINDOW) {
+    index_t count = this->noise_count_ - start;
+    if (count > ENCRYPT_WINDOW) {
+      count = ENCRYPT_WINDOW;
     }
-    // Sample secrets.
-    std::unique_ptr<OfflineSecret[]> secrets = this->MakeNoiseSecret(i);
+    // Every thread writes its secrets and ciphers to disjoint slots.
+    parallel::ParallelFor(count, [&, this](unsigned, index_t s, index_t e) {
+      std::unique_ptr<OfflineSecret[]> secrets =
+          std::make_unique<OfflineSecret[]>(remaining_parties);
+      for (index_t i = s; i < e; i++) {
+        // Sample secrets.
+        this->MakeNoiseSecret(start + i, secrets.get());
+
+        // Onion encrypt secrets directly into their (reserved) slot.
+        onion::OnionEncrypt(secrets.get(), this->party_id_ + 1,
+                            this->party_count_, this->pkeys_,
+                            this->ciphers_.GetShort(start + i),
+                            this->config_.onion_scheme);
+      }
+    });
 
-    // Onion encrypt secrets.
-    std::unique_ptr<char[]> cipher = onion::OnionEncrypt(
-        secrets.get(), this->party_id_ + 1, this->party_count_, this->pkeys_);
-    this->ciphers_.PushShort(cipher.get());
+    if ((start + count) / PROGRESS_RATE > start / PROGRESS_RATE) {
+      std::cout << "Progress " << (start + count) << "/"
+                << this->noise_count_ << std::endl;
+    }
   }
 
   auto end_time = std::chrono::steady_clock::now();
@@ -52,28 +91,47 @@ void Party::CreateNoiseCiphers() {
   std::cout << "Took " << d << "ms" << std::endl;
 }
 
-void Party::InstallSecrets() {
+void Party::InstallSecrets(parallel::Counter* received) {
   std::cout << "Decrypting offline ciphers..." << std::endl;
 
   auto start_time = std::chrono::steady_clock::now();
+  party_id_t layers = this->party_count_ - this->party_id_;
+  std::unique_ptr<OfflineSecret[]> secrets =
+      std::make_unique<OfflineSecret[]>(DECRYPT_WINDOW);
   index_t counter = 0;
-  while (this->ciphers_.HasLong()) {
-    if (++counter % PROGRESS_RATE == 0) {
-      std::cout << "Progress " << counter << "/" << this->input_count_
-                << std::endl;
+  while (counter < this->input_count_) {
+    // Wait until there are ciphers we have not decrypted yet.
+    if (!this->ciphers_.HasLong()) {
+      this->ciphers_.SetLongCount(received->WaitForMore(counter));
     }
 
-    // Decrypt cipher.
-    char* cipher = this->ciphers_.PopLong();
-    onion::OnionLayer layer = onion::OnionDecrypt(
-        cipher, this->party_count_ - this->party_id_,
-        this->party_config_.onion_pkey, this->party_config_.onion_skey);
-
-    // Install secret.
-    this->queries_state_.Store(layer.Msg());
+    // Decrypt as many ciphers as we safely can in parallel.
+    index_t count = this->ciphers_.SafeLongCount();
+    if (count > DECRYPT_WINDOW) {
+      count = DECRYPT_WINDOW;
+    }
+    parallel::ParallelFor(count, [&, this](unsigned, index_t s, index_t e) {
+      // Save next cipher layer to send directly into the batch.
+      char* ciphers = this->ciphers_.GetLong(s);
+      char* next_layers = this->ciphers_.GetNextShort(s);
+      onion::OnionDecryptBatch(ciphers, e - s, layers,
+                               this->party_config_.onion_pkey,
+                               this->party_config_.onion_skey,
+                               secrets.get() + s, next_layers,
+                               this->config_.onion_scheme);
+    });
+    this->ciphers_.AdvanceLong(count);
+
+    // Install secrets.
+    for (index_t i = 0; i < count; i++) {
+      this->queries_state_.Store(secrets[i]);
+    }
 
-    // Save next cipher layer to send.
-    this->ciphers_.PushShort(layer.NextLayer());
+    if ((counter + count) / PROGRESS_RATE > counter / PROGRESS_RATE) {
+      std::cout << "Progress " << (counter + count) << "/"
+                << this->input_count_ << std::endl;
+    }
+    counter += count;
   }
 
   auto end_time = std::chrono::steady_clock::now();
@@ -93,6 +151,11 @@ void Party::SendCiphers() {
   // we use it to find the element that should go to index i.
   // This is also uniform. However, it means the deshuffling order will not be
   // consistent. This is fine because we do not deshuffle in the offline stage.
+  // Ciphers are gathered from the batch by the kernel, GATHER_COUNT at a time.
+  size_t cipher_size = onion::CipherSize(
+      this->party_count_ - this->party_id_ - 1, this->config_.onion_scheme);
+  std::vector<iovec> gather(GATHER_COUNT);
+  size_t gathered = 0;
   for (index_t i = 0; i < this->shuffled_count_; i++) {
     if ((i + 1) % PROGRESS_RATE == 0) {
       std::cout << "Progress " << (i + 1) << "/" << this->shuffled_count_
@@ -100,19 +163,35 @@ void Party::SendCiphers() {
     }
     // Message at idx should be sent out now.
     index_t idx = this->lshuffler_.Shuffle(i);
-    this->next_.SendCipher(this->ciphers_.GetShort(idx));
+    gather[gathered++] = {this->ciphers_.GetShort(idx), cipher_size};
+    if (gathered == GATHER_COUNT) {
+      this->next_.SendCiphers(gather.data(), gathered);
+      gathered = 0;
+    }
   }
-  this->next_.FlushCiphers();
+  this->next_.SendCiphers(gather.data(), gathered);
 
   // Clear memory.
   this->lshuffler_.FinishForward();
   this->ciphers_.Free();
 }
 
-void Party::StartOffline() {
-  // Initialization.
-  this->InitializeNoiseSamples();
+void Party::StartOffline(bool pipeline) {
+  // Initialization: use precomputed noise if there is any.
+  bool precomputed = this->TakeNoiseSlot();
+  if (!precomputed) {
+    this->InitializeNoiseSamples();
+  }
+
+  // Precompute the ephemeral keys of our noise ciphers while waiting for the
+  // counts from the previous party.
+  index_t fresh_noise = precomputed ? 0 : this->noise_count_;
+  onion::StartKeyPool(
+      static_cast<size_t>(fresh_noise) *
+          (this->party_count_ - this->party_id_ - 1),
+      parallel::ThreadCount());
   this->InitializeCounts();
+  onion::StopKeyPool();
 
   // The parties are initialized; start timing.
   // State initialization and noise cipher creation can be carried out after
@@ -122,32 +201,54 @@ void Party::StartOffline() {
   auto start_time = std::chrono::steady_clock::now();
 
   // Initialize the offline states.
-  this->queries_state_.Initialize(false);
-  this->noise_state_.Initialize(this->party_count_ - this->party_id_ - 1,
-                                this->noise_count_, true, false);
-
-  // Create the noise ciphers.
-  this->CreateNoiseCiphers();
-
-  // Wait until the next server has initialized.
-  this->next_.WaitForReady();
-  this->back_.SendReady();
-
-  // Stop timing while collecting ciphers from client.
-  auto end_time = std::chrono::steady_clock::now();
-  auto d = std::chrono::duration_cast<millis>(end_time - start_time).count();
-
-  // Collect offline messages from previous party or client.
-  this->CollectCiphers();
-
-  // Batch has been received completely; resume timing.
-  start_time = std::chrono::steady_clock::now();
-
-  // Initialize the (offline) shuffler.
-  this->InitializeShuffler();
+  this->queries_state_.Initialize(false,
+                                  this->config_.onion_scheme.seeded);
+  if (!precomputed) {
+    this->noise_state_.Initialize(this->party_count_ - this->party_id_ - 1,
+                                  this->noise_count_, true, false);
+  }
 
-  // Do the offline protocol.
-  this->InstallSecrets();
+  // Cipher storage: noise ciphers first, then ciphers from previous party.
+  this->InitializeCiphers();
+  parallel::Counter received;
+
+  millis::rep d = 0;
+  if (pipeline) {
+    // Let the previous party start sending right away, and decrypt its
+    // ciphers as they arrive while creating the noise ciphers.
+    // Waiting for ciphers overlaps with work, so it is timed.
+    this->next_.WaitForReady();
+    this->back_.SendReady();
+    std::thread receiver(&Party::CollectCiphers, this, &received);
+    std::thread noise(&Party::CreateNoiseCiphers, this);
+    this->InitializeShuffler();
+    this->InstallSecrets(&received);
+    receiver.join();
+    noise.join();
+  } else {
+    // Create the noise ciphers.
+    this->CreateNoiseCiphers();
+
+    // Wait until the next server has initialized.
+    this->next_.WaitForReady();
+    this->back_.SendReady();
+
+    // Stop timing while collecting ciphers from client.
+    auto end_time = std::chrono::steady_clock::now();
+    d = std::chrono::duration_cast<millis>(end_time - start_time).count();
+
+    // Collect offline messages from previous party or client.
+    this->CollectCiphers(&received);
+
+    // Batch has been received completely; resume timing.
+    start_time = std::chrono::steady_clock::now();
+
+    // Initialize the (offline) shuffler.
+    this->InitializeShuffler();
+
+    // Do the offline protocol.
+    this->InstallSecrets(&received);
+  }
   this->SendCiphers();
 
   // Offline protocol is over; Initialize the online stage.
@@ -168,7 +269,7 @@ void Party::StartOffline() {
   this->next_.WaitForReady();
 
   // Offline stage is done!
-  end_time = std::chrono::steady_clock::now();
+  auto end_time = std::chrono::steady_clock::now();
   d += std::chrono::duration_cast<millis>(end_time - start_time).count();
   std::cout << "Offline time: " << d << "ms" << std::endl;
 
@@ -187,7 +288,8 @@ void Party::SimulateOffline() {
   this->InitializeShuffler();
 
   // Simulate the offline state.
-  this->queries_state_.Initialize(true);
+  this->queries_state_.Initialize(true,
+                                  this->config_.onion_scheme.seeded);
   this->noise_state_.Initialize(this->party_count_ - this->party_id_ - 1,
                                 this->noise_count_, true, true);
 
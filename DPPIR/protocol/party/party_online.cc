@@ -13,31 +13,44 @@ using millis = std::chrono::milliseconds;
 // Shuffle them as they come.
 void Party::CollectQueries() {
   std::cout << "Listening for queries..." << std::endl;
+  if (this->blocked_shuffle_) {
+    this->query_permuter_.Initialize(this->shuffled_count_);
+  }
   index_t read = this->noise_count_;
   while (read < this->shuffled_count_) {
     index_t remaining = this->shuffled_count_ - read;
     LogicalBuffer<Query>& buffer = this->back_.ReadQueries(remaining);
+    // Store tags for response handling.
     for (Query& in_query : buffer) {
-      // Store tag for response handling.
       this->tags_.PushBack(in_query.tag);
-      // Shuffle query.
-      index_t target = this->lshuffler_.Shuffle(read++);
-      Query& out_query = this->queries_[target];
-      // Handle query.
-      this->HandleQuery(in_query, &out_query);
+    }
+    // Handle the whole chunk.
+    this->HandleQueries(buffer.begin(), buffer.Size());
+    // Shuffle queries.
+    index_t count = buffer.Size();
+    this->chunk_targets_.resize(count);
+    this->lshuffler_.Shuffle(read, count, this->chunk_targets_.data());
+    read += count;
+    for (index_t i = 0; i < count; i++) {
+      index_t target = this->chunk_targets_[i];
+      if (this->blocked_shuffle_) {
+        this->query_permuter_.Push(buffer[i], target);
+      } else {
+        this->queries_[target] = buffer[i];
+      }
     }
     buffer.Clear();
   }
+  if (this->blocked_shuffle_) {
+    this->query_permuter_.Finish(this->queries_.begin());
+  }
 }
 
 // Send shuffled queries to the next party.
 void Party::SendQueries() {
   // Send shuffled queries.
   std::cout << "Sending queries..." << std::endl;
-  for (Query& query : this->queries_) {
-    this->next_.SendQuery(query);
-  }
-  this->next_.FlushQueries();
+  this->next_.SendQueries(this->queries_.begin(), this->queries_.Capacity());
 
   // Clear memory.
   this->lshuffler_.FinishForward();
@@ -50,25 +63,39 @@ void Party::CollectResponses() {
   // Listen to responses.
   std::cout << "Listening for responses..." << std::endl;
   this->responses_.Initialize(this->input_count_);
+  if (this->blocked_shuffle_) {
+    this->response_permuter_.Initialize(this->input_count_);
+  }
 
   index_t read = 0;
   while (read < this->shuffled_count_) {
     index_t remaining = this->shuffled_count_ - read;
     LogicalBuffer<Response>& buffer = this->next_.ReadResponses(remaining);
-    for (Response& in_response : buffer) {
-      // Deshuffle response.
-      index_t target = this->lshuffler_.Deshuffle(read++);
+    index_t count = buffer.Size();
+    // Deshuffle responses.
+    this->chunk_targets_.resize(count);
+    this->lshuffler_.Deshuffle(read, count, this->chunk_targets_.data());
+    read += count;
+    // Handle the whole chunk.
+    this->HandleResponses(buffer.begin(), this->chunk_targets_.data(), count);
+    for (index_t i = 0; i < count; i++) {
       // We do not need to handle responses to noise queries that we inject.
+      index_t target = this->chunk_targets_[i];
       if (target >= this->noise_count_) {
-        index_t target_index = target - this->noise_count_;
-        // Handle the response and store it at deshuffled index.
-        Response& out_response = this->responses_[target_index];
-        tag_t& tag = this->tags_[target_index];
-        this->HandleResponse(tag, in_response, &out_response);
+        // Store the response at deshuffled index.
+        index_t idx = target - this->noise_count_;
+        if (this->blocked_shuffle_) {
+          this->response_permuter_.Push(buffer[i], idx);
+        } else {
+          this->responses_[idx] = buffer[i];
+        }
       }
     }
     buffer.Clear();
   }
+  if (this->blocked_shuffle_) {
+    this->response_permuter_.Finish(this->responses_.begin());
+  }
 
   // Free memory.
   this->lshuffler_.FinishBackward();
@@ -78,10 +105,8 @@ void Party::CollectResponses() {
 // Send responses to the previous party.
 void Party::SendResponses() {
   std::cout << "Sending responses..." << std::endl;
-  for (Response& response : this->responses_) {
-    this->back_.SendResponse(response);
-  }
-  this->back_.FlushResponses();
+  this->back_.SendResponses(this->responses_.begin(),
+                            this->responses_.Capacity());
 
   // Clean up.
   this->responses_.Free();
@@ -0,0 +1,98 @@
+#include "DPPIR/random/random.h"
+
+namespace DPPIR {
+namespace random {
+
+// Field elements are sampled by masking 31 bits.
+static_assert(INCREMENTAL_PRIME == 0x7FFFFFFFu);
+static_assert(RANDOM_BUFFER_SIZE % sizeof(uint32_t) == 0);
+
+Sampler::Sampler()
+    : key_(),
+      nonce_(0),
+      buffer_(std::make_unique<unsigned char[]>(RANDOM_BUFFER_SIZE)),
+      offset_(RANDOM_BUFFER_SIZE) {
+  crypto_stream_chacha20_keygen(this->key_);
+}
+
+Sampler::~Sampler() {
+  sodium_memzero(this->key_, sizeof(this->key_));
+  sodium_memzero(this->buffer_.get(), RANDOM_BUFFER_SIZE);
+}
+
+void Sampler::Refill() {
+  unsigned char nonce[crypto_stream_chacha20_NONCEBYTES];
+  static_assert(sizeof(nonce) == sizeof(this->nonce_));
+  memcpy(nonce, &this->nonce_, sizeof(nonce));
+  this->nonce_++;
+  crypto_stream_chacha20(this->buffer_.get(), RANDOM_BUFFER_SIZE, nonce,
+                         this->key_);
+  this->offset_ = 0;
+}
+
+void Sampler::Fill(void* buf, size_t sz) {
+  unsigned char* ptr = static_cast<unsigned char*>(buf);
+  // Large requests are written directly with a block of their own.
+  if (sz >= RANDOM_BUFFER_SIZE) {
+    unsigned char nonce[crypto_stream_chacha20_NONCEBYTES];
+    memcpy(nonce, &this->nonce_, sizeof(nonce));
+    this->nonce_++;
+    crypto_stream_chacha20(ptr, sz, nonce, this->key_);
+    return;
+  }
+  while (sz > 0) {
+    if (this->offset_ == RANDOM_BUFFER_SIZE) {
+      this->Refill();
+    }
+    size_t n = RANDOM_BUFFER_SIZE - this->offset_;
+    if (n > sz) {
+      n = sz;
+    }
+    memcpy(ptr, this->buffer_.get() + this->offset_, n);
+    this->offset_ += n;
+    ptr += n;
+    sz -= n;
+  }
+}
+
+// https://arxiv.org/abs/1805.10941
+uint32_t Sampler::Uniform(uint32_t bound) {
+  uint64_t m = static_cast<uint64_t>(this->Next32()) * bound;
+  uint32_t low = static_cast<uint32_t>(m);
+  if (low < bound) {
+    uint32_t threshold = -bound % bound;
+    while (low < threshold) {
+      m = static_cast<uint64_t>(this->Next32()) * bound;
+      low = static_cast<uint32_t>(m);
+    }
+  }
+  return m >> 32;
+}
+
+void Sampler::UniformField(uint32_t* out, size_t count) {
+  this->Fill(out, count * sizeof(uint32_t));
+  for (size_t i = 0; i < count; i++) {
+    out[i] &= INCREMENTAL_PRIME;
+    if (out[i] == INCREMENTAL_PRIME) {
+      out[i] = this->UniformField();
+    }
+  }
+}
+
+void Sampler::UniformNonZeroField(uint32_t* out, size_t count) {
+  this->Fill(out, count * sizeof(uint32_t));
+  for (size_t i = 0; i < count; i++) {
+    out[i] &= INCREMENTAL_PRIME;
+    if (out[i] == INCREMENTAL_PRIME || out[i] == 0) {
+      out[i] = this->UniformNonZeroField();
+    }
+  }
+}
+
+Sampler& ThreadSampler() {
+  thread_local Sampler sampler;
+  return sampler;
+}
+
+}  // namespace random
+}  // namespace DPPIR
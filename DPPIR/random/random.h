@@ -0,0 +1,83 @@
+// Buffered CSPRNG for sampling secrets in bulk.
+#ifndef DPPIR_RANDOM_RANDOM_H_
+#define DPPIR_RANDOM_RANDOM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "DPPIR/types/types.h"
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+// Bytes of keystream generated per refill.
+#define RANDOM_BUFFER_SIZE (1 << 16)
+
+namespace DPPIR {
+namespace random {
+
+// ChaCha20 keystream under a random key, generated in large blocks and handed
+// out from a buffer, instead of a randombytes_*() call per value.
+// Not thread safe: every thread should use its own (see ThreadSampler()).
+class Sampler {
+ public:
+  Sampler();
+  ~Sampler();
+
+  // Writes sz random bytes to buf.
+  void Fill(void* buf, size_t sz);
+
+  // Uniform in [0, 2^32).
+  inline uint32_t Next32() {
+    if (this->offset_ + sizeof(uint32_t) > RANDOM_BUFFER_SIZE) {
+      this->Refill();
+    }
+    uint32_t v;
+    memcpy(&v, this->buffer_.get() + this->offset_, sizeof(v));
+    this->offset_ += sizeof(v);
+    return v;
+  }
+
+  // Uniform in [0, bound) (unbiased).
+  uint32_t Uniform(uint32_t bound);
+
+  // Uniform in [0, INCREMENTAL_PRIME) and in [1, INCREMENTAL_PRIME): 31 random
+  // bits, rejecting the (very unlikely) values outside of the range.
+  inline uint32_t UniformField() {
+    uint32_t v;
+    do {
+      v = this->Next32() & INCREMENTAL_PRIME;
+    } while (v == INCREMENTAL_PRIME);
+    return v;
+  }
+  inline uint32_t UniformNonZeroField() {
+    uint32_t v;
+    do {
+      v = this->Next32() & INCREMENTAL_PRIME;
+    } while (v == INCREMENTAL_PRIME || v == 0);
+    return v;
+  }
+
+  // Bulk versions: fill out[0, count).
+  void UniformField(uint32_t* out, size_t count);
+  void UniformNonZeroField(uint32_t* out, size_t count);
+
+ private:
+  void Refill();
+
+  unsigned char key_[crypto_stream_chacha20_KEYBYTES];
+  // Every block of keystream uses a fresh nonce.
+  uint64_t nonce_;
+  std::unique_ptr<unsigned char[]> buffer_;
+  // buffer_[offset_, RANDOM_BUFFER_SIZE) is unused.
+  size_t offset_;
+};
+
+// The calling thread's sampler.
+Sampler& ThreadSampler();
+
+}  // namespace random
+}  // namespace DPPIR
+
+#endif  // DPPIR_RANDOM_RANDOM_H_
@@ -0,0 +1,109 @@
+// Tests the ranges and (roughly) the distribution of the buffered sampler.
+
+#include "DPPIR/random/random.h"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+// NOLINTNEXTLINE
+#include <thread>
+#include <vector>
+
+#include "DPPIR/types/types.h"
+
+#define SAMPLES 1000000
+#define BUCKETS 16
+
+namespace DPPIR {
+namespace random {
+
+// Every bucket should get the same number of samples, give or take 5%.
+bool CheckBuckets(const std::vector<size_t>& buckets, const char* label) {
+  double expected = SAMPLES / buckets.size();
+  for (size_t count : buckets) {
+    if (count < expected * 0.95 || count > expected * 1.05) {
+      std::cout << label << " is not uniform" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TestUniform(uint32_t bound) {
+  Sampler& sampler = ThreadSampler();
+  size_t bucket_count = bound < BUCKETS ? bound : BUCKETS;
+  std::vector<size_t> buckets(bucket_count, 0);
+  for (size_t i = 0; i < SAMPLES; i++) {
+    uint32_t v = sampler.Uniform(bound);
+    if (v >= bound) {
+      std::cout << "Uniform(" << bound << ") = " << v << std::endl;
+      return false;
+    }
+    buckets[static_cast<uint64_t>(v) * bucket_count / bound]++;
+  }
+  return CheckBuckets(buckets, "Uniform");
+}
+
+bool TestField() {
+  Sampler& sampler = ThreadSampler();
+  std::unique_ptr<uint32_t[]> bulk = std::make_unique<uint32_t[]>(SAMPLES);
+  std::unique_ptr<uint32_t[]> nonzero = std::make_unique<uint32_t[]>(SAMPLES);
+  sampler.UniformField(bulk.get(), SAMPLES);
+  sampler.UniformNonZeroField(nonzero.get(), SAMPLES);
+
+  std::vector<size_t> buckets(BUCKETS, 0);
+  for (size_t i = 0; i < SAMPLES; i++) {
+    uint32_t single = sampler.UniformField();
+    uint32_t single_nonzero = sampler.UniformNonZeroField();
+    if (single >= INCREMENTAL_PRIME || bulk[i] >= INCREMENTAL_PRIME) {
+      std::cout << "Field element out of range" << std::endl;
+      return false;
+    }
+    if (single_nonzero == 0 || single_nonzero >= INCREMENTAL_PRIME ||
+        nonzero[i] == 0 || nonzero[i] >= INCREMENTAL_PRIME) {
+      std::cout << "Non-zero field element out of range" << std::endl;
+      return false;
+    }
+    buckets[static_cast<uint64_t>(bulk[i]) * BUCKETS / INCREMENTAL_PRIME]++;
+  }
+  return CheckBuckets(buckets, "UniformField");
+}
+
+// Consecutive fills (small and large) and different threads must not repeat
+// the stream.
+bool TestFill() {
+  std::vector<uint64_t> values(4);
+  ThreadSampler().Fill(&values[0], sizeof(uint64_t));
+  std::vector<uint64_t> large(RANDOM_BUFFER_SIZE / sizeof(uint64_t) + 3);
+  ThreadSampler().Fill(large.data(), large.size() * sizeof(uint64_t));
+  values[1] = large.back();
+  ThreadSampler().Fill(&values[2], sizeof(uint64_t));
+  std::thread thread([&]() {
+    ThreadSampler().Fill(&values[3], sizeof(uint64_t));
+  });
+  thread.join();
+
+  for (size_t i = 0; i < values.size(); i++) {
+    for (size_t j = i + 1; j < values.size(); j++) {
+      if (values[i] == values[j]) {
+        std::cout << "Repeated random values" << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace random
+}  // namespace DPPIR
+
+int main() {
+  if (!DPPIR::random::TestUniform(7) || !DPPIR::random::TestUniform(1000) ||
+      !DPPIR::random::TestUniform(3000000000u) ||
+      !DPPIR::random::TestField() || !DPPIR::random::TestFill()) {
+    std::cout << "Test failed!" << std::endl;
+    return 1;
+  }
+  std::cout << "All tests passed!" << std::endl;
+  return 0;
+}
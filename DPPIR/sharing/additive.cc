@@ -1,39 +1,146 @@
 #include "DPPIR/sharing/additive.h"
 
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "DPPIR/random/random.h"
 // NOLINTNEXTLINE
 #include "sodium.h"
 
 namespace DPPIR {
 namespace sharing {
 
-// Helper XOR.
+// Helper XOR: dst = left ^ right over sz bytes. dst may alias either input.
 namespace {
 
-void XOR(const char* tally, const char* share, char* dst, size_t sz) {
-  const uint32_t* tally_ptr = reinterpret_cast<const uint32_t*>(tally);
-  const uint32_t* share_ptr = reinterpret_cast<const uint32_t*>(share);
-  uint32_t* dst_ptr = reinterpret_cast<uint32_t*>(dst);
-  size_t ptr_sz = sz / sizeof(uint32_t);
-  for (size_t i = 0; i < ptr_sz; i++) {
-    dst_ptr[i] = tally_ptr[i] ^ share_ptr[i];
+void XORScalar(const char* left, const char* right, char* dst, size_t sz) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= sz; i += sizeof(uint64_t)) {
+    uint64_t l, r;
+    memcpy(&l, left + i, sizeof(l));
+    memcpy(&r, right + i, sizeof(r));
+    l ^= r;
+    memcpy(dst + i, &l, sizeof(l));
+  }
+  for (; i < sz; i++) {
+    dst[i] = left[i] ^ right[i];
+  }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) void XORAVX2(const char* left,
+                                             const char* right, char* dst,
+                                             size_t sz) {
+  size_t i = 0;
+  for (; i + sizeof(__m256i) <= sz; i += sizeof(__m256i)) {
+    __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+    __m256i r =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_xor_si256(l, r));
+  }
+  XORScalar(left + i, right + i, dst + i, sz - i);
+}
+
+__attribute__((target("avx512f"))) void XORAVX512(const char* left,
+                                                  const char* right,
+                                                  char* dst, size_t sz) {
+  size_t i = 0;
+  for (; i + sizeof(__m512i) <= sz; i += sizeof(__m512i)) {
+    __m512i l = _mm512_loadu_si512(left + i);
+    __m512i r = _mm512_loadu_si512(right + i);
+    _mm512_storeu_si512(dst + i, _mm512_xor_si512(l, r));
   }
+  XORScalar(left + i, right + i, dst + i, sz - i);
+}
+#endif
+
+using XORKernel = void (*)(const char*, const char*, char*, size_t);
+
+// Picks the widest kernel the CPU supports.
+XORKernel SelectKernel() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return &XORAVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return &XORAVX2;
+  }
+#endif
+  return &XORScalar;
+}
+
+void XOR(const char* left, const char* right, char* dst, size_t sz) {
+  static const XORKernel kernel = SelectKernel();
+  kernel(left, right, dst, sz);
 }
 
 }  // namespace
 
 std::vector<preshare_t> GenerateAdditiveSecretShares(size_t n) {
-  std::vector<preshare_t> shares;
+  std::vector<preshare_t> shares(n);
+  GenerateAdditiveSecretSharesBatch(n, 1, shares.data());
+  return shares;
+}
+
+void GenerateAdditiveSecretSharesBatch(size_t n, size_t count,
+                                       preshare_t* shares) {
+  for (size_t i = 0; i < count; i++) {
+    preshare_t* set = shares + i * n;
+    // n - 1 random shares, the last one is their XOR.
+    random::ThreadSampler().Fill(set, (n - 1) * sizeof(preshare_t));
+    preshare_t& last = set[n - 1];
+    last.fill(0);
+    for (size_t j = 0; j < n - 1; j++) {
+      XOR(last.data(), set[j].data(), last.data(), last.size());
+    }
+  }
+}
+
+std::vector<preshare_seed_t> GenerateSeededAdditiveSecretShares(
+    size_t n, preshare_t* last) {
+  std::vector<preshare_seed_t> seeds(n - 1);
 
   preshare_t acc{};  // 0-initialized.
-  for (size_t i = 0; i < n - 1; i++) {
-    shares.emplace_back();
-    preshare_t& share = shares.back();
-    randombytes_buf(share.data(), share.size());
+  preshare_t share;
+  random::Sampler& sampler = random::ThreadSampler();
+  for (preshare_seed_t& seed : seeds) {
+    sampler.Fill(seed.data(), seed.size());
+    ExpandAdditiveSeed(seed, &share);
     XOR(acc.data(), share.data(), acc.data(), share.size());
   }
-  shares.push_back(acc);
+  *last = acc;
 
-  return shares;
+  return seeds;
+}
+
+void ExpandAdditiveSeed(const preshare_seed_t& seed, preshare_t* share) {
+  crypto_generichash(reinterpret_cast<unsigned char*>(share->data()),
+                     share->size(),
+                     reinterpret_cast<const unsigned char*>(seed.data()),
+                     seed.size(), nullptr, 0);
+}
+
+preshare_t GenerateAdditivePreshares(size_t n, bool seeded,
+                                     OfflineSecret* secrets) {
+  if (seeded) {
+    preshare_t last;
+    std::vector<preshare_seed_t> seeds =
+        GenerateSeededAdditiveSecretShares(n, &last);
+    for (size_t i = 0; i < n - 1; i++) {
+      memcpy(secrets[i].preshare.data(), seeds[i].data(), seeds[i].size());
+    }
+    return last;
+  }
+  std::vector<preshare_t> shares = GenerateAdditiveSecretShares(n);
+  for (size_t i = 0; i < n - 1; i++) {
+    secrets[i].preshare = shares[i];
+  }
+  return shares.back();
 }
 
 void AdditiveReconstruct(const Response& tally, const preshare_t& share,
@@ -43,5 +150,15 @@ void AdditiveReconstruct(const Response& tally, const preshare_t& share,
   XOR(tally_ptr, share.data(), target_ptr, share.size());
 }
 
+void AdditiveReconstructBatch(const Response* tallies,
+                              const preshare_t* shares, size_t count,
+                              Response* targets) {
+  // Both are packed arrays of the same size.
+  const char* tallies_ptr = reinterpret_cast<const char*>(tallies);
+  const char* shares_ptr = reinterpret_cast<const char*>(shares);
+  char* targets_ptr = reinterpret_cast<char*>(targets);
+  XOR(tallies_ptr, shares_ptr, targets_ptr, count * sizeof(preshare_t));
+}
+
 }  // namespace sharing
 }  // namespace DPPIR
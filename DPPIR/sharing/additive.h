@@ -13,6 +13,24 @@ namespace sharing {
 // Creates n secret shares of zero.
 std::vector<preshare_t> GenerateAdditiveSecretShares(size_t n);
 
+// Creates count independent sets of n secret shares of zero, set i is written
+// to shares[i * n, (i + 1) * n).
+void GenerateAdditiveSecretSharesBatch(size_t n, size_t count,
+                                       preshare_t* shares);
+
+// Seed-based variant: the first n - 1 shares are given as short seeds (see
+// ExpandAdditiveSeed()) and are returned, the last share is written to last.
+std::vector<preshare_seed_t> GenerateSeededAdditiveSecretShares(
+    size_t n, preshare_t* last);
+
+// Expands a seed into the share it stands for.
+void ExpandAdditiveSeed(const preshare_seed_t& seed, preshare_t* share);
+
+// Fills the preshares of secrets[0, n - 1) with n - 1 out of n shares of zero,
+// as seeds if seeded (see SEEDED_SECRET_SIZE). Returns the last share.
+preshare_t GenerateAdditivePreshares(size_t n, bool seeded,
+                                     OfflineSecret* secrets);
+
 // (Partial/incremental) reconstruction: given a current tally and a share,
 // the function returns a new tally that includes this share.
 // If this function is called on all the shares returned by
@@ -22,6 +40,12 @@ std::vector<preshare_t> GenerateAdditiveSecretShares(size_t n);
 void AdditiveReconstruct(const Response& tally, const preshare_t& share,
                          Response* target);
 
+// Batch version: targets[i] = AdditiveReconstruct(tallies[i], shares[i]).
+// Uses AVX-512 or AVX2 if the CPU supports them. targets may alias tallies.
+void AdditiveReconstructBatch(const Response* tallies,
+                              const preshare_t* shares, size_t count,
+                              Response* targets);
+
 }  // namespace sharing
 }  // namespace DPPIR
 
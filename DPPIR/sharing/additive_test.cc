@@ -10,6 +10,7 @@
 #include "DPPIR/sharing/additive.h"
 
 #include <iostream>
+#include <vector>
 
 // NOLINTNEXTLINE
 #include "sodium.h"
@@ -31,6 +32,48 @@ Response Test(Response value, size_t numparties) {
   return value;
 }
 
+Response TestSeeded(Response value, size_t numparties) {
+  // Same, but all shares but the last are seeds.
+  preshare_t last;
+  auto seeds = GenerateSeededAdditiveSecretShares(numparties, &last);
+  for (const auto& seed : seeds) {
+    preshare_t share;
+    ExpandAdditiveSeed(seed, &share);
+    AdditiveReconstruct(value, share, &value);
+  }
+  AdditiveReconstruct(value, last, &value);
+  return value;
+}
+
+// Shares count values at once with the batch APIs: every value must be
+// reconstructed, including in place and for counts that are not a multiple of
+// the vector width.
+bool TestBatch(size_t count, size_t numparties) {
+  std::vector<Response> values(count);
+  randombytes_buf(values.data(), count * sizeof(Response));
+  std::vector<preshare_t> shares(count * numparties);
+  GenerateAdditiveSecretSharesBatch(numparties, count, shares.data());
+
+  std::vector<Response> tallies = values;
+  std::vector<preshare_t> party_shares(count);
+  for (size_t party = 0; party < numparties; party++) {
+    for (size_t i = 0; i < count; i++) {
+      party_shares[i] = shares[i * numparties + party];
+    }
+    // Must match the single response API.
+    std::vector<Response> expected(count);
+    for (size_t i = 0; i < count; i++) {
+      AdditiveReconstruct(tallies[i], party_shares[i], &expected[i]);
+    }
+    AdditiveReconstructBatch(tallies.data(), party_shares.data(), count,
+                             tallies.data());
+    if (tallies != expected) {
+      return false;
+    }
+  }
+  return tallies == values;
+}
+
 }  // namespace sharing
 }  // namespace DPPIR
 
@@ -40,11 +83,21 @@ int main() {
     randombytes_buf(reinterpret_cast<char*>(&value), sizeof(value));
     size_t numparties = randombytes_uniform(5) + 2;
     DPPIR::Response reconstructed = DPPIR::sharing::Test(value, numparties);
-    if (value != reconstructed) {
+    DPPIR::Response seeded = DPPIR::sharing::TestSeeded(value, numparties);
+    if (value != reconstructed || value != seeded) {
       std::cout << "Test failed!" << std::endl;
       std::cout << "Parties: " << numparties << std::endl;
       std::cout << "Value: " << value << std::endl;
       std::cout << "Reconstructed: " << reconstructed << std::endl;
+      std::cout << "Reconstructed (seeded): " << seeded << std::endl;
+      return 1;
+    }
+  }
+
+  for (size_t count = 0; count < 40; count++) {
+    if (!DPPIR::sharing::TestBatch(count, randombytes_uniform(5) + 2)) {
+      std::cout << "Test failed!" << std::endl;
+      std::cout << "Batch of " << count << std::endl;
       return 1;
     }
   }
@@ -0,0 +1,60 @@
+// Arithmetic in the prime field of incremental secret sharing.
+//
+// INCREMENTAL_PRIME is the Mersenne prime p = 2^31 - 1. Since 2^31 = 1 (mod p),
+// a value can be reduced by adding its high bits (above bit 31) to its low
+// bits, which needs no division.
+
+#ifndef DPPIR_SHARING_FIELD_H_
+#define DPPIR_SHARING_FIELD_H_
+
+#include <cstdint>
+
+#include "DPPIR/types/types.h"
+
+namespace DPPIR {
+namespace sharing {
+namespace field {
+
+static_assert(INCREMENTAL_PRIME == (1u << 31) - 1);
+
+// Reduces any 64 bit value to [0, p).
+inline uint32_t Reduce(uint64_t v) {
+  v = (v & INCREMENTAL_PRIME) + (v >> 31);  // < 2^34.
+  v = (v & INCREMENTAL_PRIME) + (v >> 31);  // <= p + 7.
+  return v >= INCREMENTAL_PRIME ? v - INCREMENTAL_PRIME : v;
+}
+
+// Operands must be in [0, p).
+inline uint32_t Add(uint32_t a, uint32_t b) {
+  uint32_t s = a + b;
+  return s >= INCREMENTAL_PRIME ? s - INCREMENTAL_PRIME : s;
+}
+inline uint32_t Sub(uint32_t a, uint32_t b) {
+  return a >= b ? a - b : a + INCREMENTAL_PRIME - b;
+}
+inline uint32_t Mul(uint32_t a, uint32_t b) {
+  return Reduce(static_cast<uint64_t>(a) * b);
+}
+// a * b + c.
+inline uint32_t MulAdd(uint32_t a, uint32_t b, uint32_t c) {
+  return Reduce(static_cast<uint64_t>(a) * b + c);
+}
+
+// Multiplicative inverse of a != 0, as a^(p - 2).
+inline uint32_t Inverse(uint32_t a) {
+  uint32_t result = 1;
+  uint32_t base = a;
+  for (uint32_t e = INCREMENTAL_PRIME - 2; e > 0; e >>= 1) {
+    if (e & 1) {
+      result = Mul(result, base);
+    }
+    base = Mul(base, base);
+  }
+  return result;
+}
+
+}  // namespace field
+}  // namespace sharing
+}  // namespace DPPIR
+
+#endif  // DPPIR_SHARING_FIELD_H_
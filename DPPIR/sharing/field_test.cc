@@ -0,0 +1,93 @@
+// Tests the shift-and-add field arithmetic against plain % arithmetic.
+
+#include "DPPIR/sharing/field.h"
+
+#include <cstdint>
+#include <iostream>
+
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+namespace DPPIR {
+namespace sharing {
+namespace field {
+
+#define P static_cast<uint64_t>(INCREMENTAL_PRIME)
+
+bool Test(uint32_t a, uint32_t b, uint32_t c) {
+  if (Add(a, b) != (a + P + b) % P) {
+    std::cout << "Add(" << a << ", " << b << ")" << std::endl;
+    return false;
+  }
+  if (Sub(a, b) != (a + P - b) % P) {
+    std::cout << "Sub(" << a << ", " << b << ")" << std::endl;
+    return false;
+  }
+  if (Mul(a, b) != (a * static_cast<uint64_t>(b)) % P) {
+    std::cout << "Mul(" << a << ", " << b << ")" << std::endl;
+    return false;
+  }
+  if (MulAdd(a, b, c) != (a * static_cast<uint64_t>(b) + c) % P) {
+    std::cout << "MulAdd(" << a << ", " << b << ", " << c << ")" << std::endl;
+    return false;
+  }
+  if (a != 0 && Mul(a, Inverse(a)) != 1) {
+    std::cout << "Inverse(" << a << ")" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool TestReduce(uint64_t v) {
+  if (Reduce(v) != v % P) {
+    std::cout << "Reduce(" << v << ")" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace field
+}  // namespace sharing
+}  // namespace DPPIR
+
+int main() {
+  using DPPIR::sharing::field::Test;
+  using DPPIR::sharing::field::TestReduce;
+
+  for (int i = 0; i < 100000; i++) {
+    uint32_t a = randombytes_uniform(INCREMENTAL_PRIME);
+    uint32_t b = randombytes_uniform(INCREMENTAL_PRIME);
+    uint32_t c = randombytes_uniform(INCREMENTAL_PRIME);
+    uint64_t v;
+    randombytes_buf(&v, sizeof(v));
+    if (!Test(a, b, c) || !TestReduce(v)) {
+      std::cout << "Test failed!" << std::endl;
+      return 1;
+    }
+  }
+
+  // Edge cases.
+  const uint32_t edges[4] = {0, 1, INCREMENTAL_PRIME - 2,
+                             INCREMENTAL_PRIME - 1};
+  for (uint32_t a : edges) {
+    for (uint32_t b : edges) {
+      for (uint32_t c : edges) {
+        if (!Test(a, b, c)) {
+          std::cout << "Test failed!" << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+  const uint64_t values[6] = {0, INCREMENTAL_PRIME, 1ull << 31, 1ull << 62,
+                              UINT64_MAX, UINT64_MAX - INCREMENTAL_PRIME};
+  for (uint64_t v : values) {
+    if (!TestReduce(v)) {
+      std::cout << "Test failed!" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "All tests passed!" << std::endl;
+  return 0;
+}
@@ -1,59 +1,162 @@
 #include "DPPIR/sharing/incremental.h"
 
-// NOLINTNEXTLINE
-#include "sodium.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "DPPIR/random/random.h"
+#include "DPPIR/sharing/field.h"
 
 namespace DPPIR {
 namespace sharing {
 
-namespace {
+std::vector<incremental_share_t> PreIncrementalSecretShares(size_t n) {
+  std::vector<incremental_share_t> shares(n);
+  PreIncrementalSecretShares(n, shares.data());
+  return shares;
+}
 
-// multiplicative modulo inverse using extended Euclid algorithm.
-void GcdExtended(uint32_t a, uint32_t b, int64_t* x, int64_t* y) {
-  // Base Case
-  if (a == 0) {
-    *x = 0;
-    *y = 1;
-    return;
+void PreIncrementalSecretShares(size_t n, incremental_share_t* shares) {
+  random::Sampler& sampler = random::ThreadSampler();
+  for (size_t i = 0; i < n; i++) {
+    shares[i].x = sampler.UniformField();
+    shares[i].y = sampler.UniformNonZeroField();
   }
-  GcdExtended(b % a, a, y, x);
-  *x = *x - (b / a) * *y;
 }
 
-// Function to find modulo inverse of a
-uint32_t ModInverse(uint32_t a, uint32_t m) {
-  int64_t x, y;
-  GcdExtended(a, m, &x, &y);
-  return (x < 0 ? x + m : x) % m;
+std::vector<incremental_inverse_t> InvertIncrementalShares(
+    const std::vector<incremental_share_t>& preshares) {
+  std::vector<incremental_inverse_t> inverses(preshares.size());
+  InvertIncrementalShares(preshares.data(), preshares.size(), inverses.data());
+  return inverses;
 }
 
-}  // namespace
-
-std::vector<incremental_share_t> PreIncrementalSecretShares(size_t n) {
-  std::vector<incremental_share_t> shares;
-  for (uint32_t i = 0; i < n; i++) {
-    uint32_t x = randombytes_uniform(INCREMENTAL_PRIME);
-    uint32_t y = randombytes_uniform(INCREMENTAL_PRIME - 1) + 1;
-    shares.push_back({x, y});
+void InvertIncrementalShares(const incremental_share_t* preshares, size_t n,
+                             incremental_inverse_t* inverses) {
+  for (size_t i = 0; i < n; i++) {
+    inverses[i] = {preshares[i].x, field::Inverse(preshares[i].y)};
   }
-  return shares;
 }
 
 incremental_tally_t GenerateIncrementalTally(
     key_t query, const std::vector<incremental_share_t>& preshares) {
-  // Turn query to uint64_t so operations with x and y fit.
-  uint64_t t = query;
-  for (size_t i = preshares.size(); i > 0; i--) {
-    const auto& share = preshares.at(i - 1);
-    t = t + (t < share.x ? INCREMENTAL_PRIME : 0) - share.x;
-    t = (t * ModInverse(share.y, INCREMENTAL_PRIME)) % INCREMENTAL_PRIME;
+  return GenerateIncrementalTally(query, InvertIncrementalShares(preshares));
+}
+
+incremental_tally_t GenerateIncrementalTally(
+    key_t query, const std::vector<incremental_inverse_t>& inverses) {
+  return GenerateIncrementalTally(query, inverses.data(), inverses.size());
+}
+
+incremental_tally_t GenerateIncrementalTally(
+    key_t query, const incremental_inverse_t* inverses, size_t n) {
+  // Undo the shares in reverse order: t = (t - x) * y^-1.
+  uint32_t t = query;
+  for (size_t i = n; i > 0; i--) {
+    const incremental_inverse_t& inverse = inverses[i - 1];
+    t = field::Mul(field::Sub(t, inverse.x), inverse.y_inverse);
   }
   return t;
 }
 
 incremental_tally_t IncrementalReconstruct(incremental_tally_t tally,
                                            const incremental_share_t& share) {
-  return (static_cast<uint64_t>(tally) * share.y + share.x) % INCREMENTAL_PRIME;
+  return field::MulAdd(tally, share.y, share.x);
+}
+
+namespace {
+
+void ReconstructScalar(const incremental_tally_t* tallies,
+                       const incremental_share_t* shares, size_t count,
+                       incremental_tally_t* out) {
+  for (size_t i = 0; i < count; i++) {
+    out[i] = field::MulAdd(tallies[i], shares[i].y, shares[i].x);
+  }
+}
+
+#if defined(__x86_64__)
+// Each 64 bit lane of the shares holds one share, x in the low half and y in
+// the high half. Tallies are widened to 64 bit lanes, multiplied with y (a
+// 32x32->64 bit multiply), and narrowed back after reduction.
+
+__attribute__((target("avx2"))) void ReconstructAVX2(
+    const incremental_tally_t* tallies, const incremental_share_t* shares,
+    size_t count, incremental_tally_t* out) {
+  const __m256i p = _mm256_set1_epi64x(INCREMENTAL_PRIME);
+  const __m256i p_minus_1 = _mm256_set1_epi64x(INCREMENTAL_PRIME - 1);
+  const __m256i low = _mm256_set1_epi64x(0xFFFFFFFF);
+  const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i t = _mm256_cvtepu32_epi64(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(tallies + i)));
+    __m256i s =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(shares + i));
+    __m256i y = _mm256_srli_epi64(s, 32);
+    __m256i x = _mm256_and_si256(s, low);
+    __m256i v = _mm256_add_epi64(_mm256_mul_epu32(t, y), x);
+    // Same as field::Reduce(); values are small enough for a signed compare.
+    v = _mm256_add_epi64(_mm256_and_si256(v, p), _mm256_srli_epi64(v, 31));
+    v = _mm256_add_epi64(_mm256_and_si256(v, p), _mm256_srli_epi64(v, 31));
+    __m256i ge = _mm256_cmpgt_epi64(v, p_minus_1);
+    v = _mm256_sub_epi64(v, _mm256_and_si256(ge, p));
+    __m256i r = _mm256_permutevar8x32_epi32(v, narrow);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm256_castsi256_si128(r));
+  }
+  ReconstructScalar(tallies + i, shares + i, count - i, out + i);
+}
+
+__attribute__((target("avx512f"))) void ReconstructAVX512(
+    const incremental_tally_t* tallies, const incremental_share_t* shares,
+    size_t count, incremental_tally_t* out) {
+  const __m512i p = _mm512_set1_epi64(INCREMENTAL_PRIME);
+  const __m512i low = _mm512_set1_epi64(0xFFFFFFFF);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m512i t = _mm512_cvtepu32_epi64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tallies + i)));
+    __m512i s = _mm512_loadu_si512(shares + i);
+    __m512i y = _mm512_srli_epi64(s, 32);
+    __m512i x = _mm512_and_si512(s, low);
+    __m512i v = _mm512_add_epi64(_mm512_mul_epu32(t, y), x);
+    // Same as field::Reduce().
+    v = _mm512_add_epi64(_mm512_and_si512(v, p), _mm512_srli_epi64(v, 31));
+    v = _mm512_add_epi64(_mm512_and_si512(v, p), _mm512_srli_epi64(v, 31));
+    __mmask8 ge = _mm512_cmpge_epu64_mask(v, p);
+    v = _mm512_mask_sub_epi64(v, ge, v, p);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm512_cvtepi64_epi32(v));
+  }
+  ReconstructScalar(tallies + i, shares + i, count - i, out + i);
+}
+#endif
+
+using ReconstructKernel = void (*)(const incremental_tally_t*,
+                                   const incremental_share_t*, size_t,
+                                   incremental_tally_t*);
+
+// Picks the widest kernel the CPU supports.
+ReconstructKernel SelectKernel() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return &ReconstructAVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return &ReconstructAVX2;
+  }
+#endif
+  return &ReconstructScalar;
+}
+
+}  // namespace
+
+void IncrementalReconstructBatch(const incremental_tally_t* tallies,
+                                 const incremental_share_t* shares,
+                                 size_t count, incremental_tally_t* out) {
+  static const ReconstructKernel kernel = SelectKernel();
+  kernel(tallies, shares, count, out);
 }
 
 }  // namespace sharing
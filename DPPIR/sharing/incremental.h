@@ -11,11 +11,25 @@ namespace DPPIR {
 namespace sharing {
 
 // Generates random preshares of an value that is yet to be determined.
+// Sampled from the calling thread's buffered sampler (see DPPIR/random).
 std::vector<incremental_share_t> PreIncrementalSecretShares(size_t n);
+void PreIncrementalSecretShares(size_t n, incremental_share_t *shares);
+
+// Precomputes what GenerateIncrementalTally() needs from the preshares (the
+// inverses of their y components). Meant to be called once, when preshares
+// are sampled, rather than on every tally.
+std::vector<incremental_inverse_t> InvertIncrementalShares(
+    const std::vector<incremental_share_t> &preshares);
+void InvertIncrementalShares(const incremental_share_t *preshares, size_t n,
+                             incremental_inverse_t *inverses);
 
 // Compute the tally to secret share query using the given preshares.
 incremental_tally_t GenerateIncrementalTally(
     key_t query, const std::vector<incremental_share_t> &preshares);
+incremental_tally_t GenerateIncrementalTally(
+    key_t query, const std::vector<incremental_inverse_t> &inverses);
+incremental_tally_t GenerateIncrementalTally(
+    key_t query, const incremental_inverse_t *inverses, size_t n);
 
 // (Partial/incremental) reconstruction: given a current tally and a share,
 // the function returns a new tally that includes this share.
@@ -27,6 +41,12 @@ incremental_tally_t GenerateIncrementalTally(
 incremental_tally_t IncrementalReconstruct(incremental_tally_t tally,
                                            const incremental_share_t &share);
 
+// Batch version: out[i] = IncrementalReconstruct(tallies[i], shares[i]).
+// Uses AVX-512 or AVX2 if the CPU supports them. out may alias tallies.
+void IncrementalReconstructBatch(const incremental_tally_t *tallies,
+                                 const incremental_share_t *shares,
+                                 size_t count, incremental_tally_t *out);
+
 }  // namespace sharing
 }  // namespace DPPIR
 
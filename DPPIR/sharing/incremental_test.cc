@@ -8,6 +8,7 @@
 #include "DPPIR/sharing/incremental.h"
 
 #include <iostream>
+#include <vector>
 
 // NOLINTNEXTLINE
 #include "sodium.h"
@@ -19,8 +20,13 @@ key_t Test(key_t value, size_t numparties) {
   // Pre-secret share into numparties-many shares.
   auto shares = PreIncrementalSecretShares(numparties);
 
-  // Compute the final piece of the sharing using value and preshares.
+  // Compute the final piece of the sharing using value and preshares, the
+  // precomputed inverses must give the same tally.
   incremental_tally_t tally = GenerateIncrementalTally(value, shares);
+  auto inverses = InvertIncrementalShares(shares);
+  if (tally != GenerateIncrementalTally(value, inverses)) {
+    return value + 1;  // Fails the test.
+  }
 
   // Reconstruct the value incrementally, in order of shares.
   for (const auto &share : shares) {
@@ -32,6 +38,31 @@ key_t Test(key_t value, size_t numparties) {
   return tally;
 }
 
+// The batch API must agree with IncrementalReconstruct(), including when
+// reconstructing in place and for counts that are not a multiple of the
+// vector width.
+bool TestBatch(size_t count) {
+  std::vector<incremental_tally_t> tallies(count);
+  std::vector<incremental_share_t> shares = PreIncrementalSecretShares(count);
+  for (size_t i = 0; i < count; i++) {
+    tallies[i] = randombytes_uniform(INCREMENTAL_PRIME);
+  }
+  if (count > 0) {
+    tallies[0] = INCREMENTAL_PRIME - 1;
+    shares[0] = {INCREMENTAL_PRIME - 1, INCREMENTAL_PRIME - 1};
+  }
+  std::vector<incremental_tally_t> out(count);
+  IncrementalReconstructBatch(tallies.data(), shares.data(), count, out.data());
+  for (size_t i = 0; i < count; i++) {
+    if (out[i] != IncrementalReconstruct(tallies[i], shares[i])) {
+      return false;
+    }
+  }
+  IncrementalReconstructBatch(tallies.data(), shares.data(), count,
+                              tallies.data());
+  return tallies == out;
+}
+
 }  // namespace sharing
 }  // namespace DPPIR
 
@@ -62,6 +93,19 @@ int main() {
     return 1;
   }
 
+  for (size_t count = 0; count < 40; count++) {
+    if (!DPPIR::sharing::TestBatch(count)) {
+      std::cout << "Test failed!" << std::endl;
+      std::cout << "Batch of " << count << std::endl;
+      return 1;
+    }
+  }
+  if (!DPPIR::sharing::TestBatch(100003)) {
+    std::cout << "Test failed!" << std::endl;
+    std::cout << "Large batch" << std::endl;
+    return 1;
+  }
+
   std::cout << "All tests passed!" << std::endl;
   return 0;
 }
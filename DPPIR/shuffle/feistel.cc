@@ -0,0 +1,173 @@
+#include "DPPIR/shuffle/feistel.h"
+
+#include <cassert>
+#include <vector>
+
+#include "DPPIR/shuffle/util.h"
+
+namespace DPPIR {
+namespace shuffle {
+
+namespace {
+
+// The network of a Feistel.
+struct Network {
+  const uint16_t* tables;
+  const uint32_t* offsets;
+  unsigned left_bits;
+  unsigned right_bits;
+  index_t n;
+};
+
+// Round r maps (a, b) to (b, a ^ F_r(b)), and a has left_bits in even rounds
+// and right_bits in odd rounds.
+inline index_t Rounds(const Network& net, index_t x) {
+  index_t a = x >> net.right_bits;
+  index_t b = x & ((index_t(1) << net.right_bits) - 1);
+  for (unsigned r = 0; r < FEISTEL_ROUNDS; r++) {
+    index_t c = a ^ net.tables[net.offsets[r] + b];
+    a = b;
+    b = c;
+  }
+  return (a << net.right_bits) | b;
+}
+
+inline index_t InverseRounds(const Network& net, index_t y) {
+  index_t a = y >> net.right_bits;
+  index_t b = y & ((index_t(1) << net.right_bits) - 1);
+  for (unsigned r = FEISTEL_ROUNDS; r > 0; r--) {
+    index_t c = b ^ net.tables[net.offsets[r - 1] + a];
+    b = a;
+    a = c;
+  }
+  return (a << net.right_bits) | b;
+}
+
+// Cycle walking: the first element of the cycle of x that is in [0, n).
+template <bool inverse>
+inline index_t Walk(const Network& net, index_t x) {
+  do {
+    x = inverse ? InverseRounds(net, x) : Rounds(net, x);
+  } while (x >= net.n);
+  return x;
+}
+
+// Rounds (resp. InverseRounds) of 8 elements at once: rounds of different
+// elements are independent, so their table lookups overlap.
+template <bool inverse>
+inline void Rounds8(const Network& net, index_t* x) {
+  const index_t right_mask = (index_t(1) << net.right_bits) - 1;
+  index_t a[8];
+  index_t b[8];
+  for (unsigned j = 0; j < 8; j++) {
+    a[j] = x[j] >> net.right_bits;
+    b[j] = x[j] & right_mask;
+  }
+  for (unsigned i = 0; i < FEISTEL_ROUNDS; i++) {
+    unsigned r = inverse ? FEISTEL_ROUNDS - 1 - i : i;
+    const uint16_t* table = net.tables + net.offsets[r];
+    for (unsigned j = 0; j < 8; j++) {
+      if (inverse) {
+        index_t c = b[j] ^ table[a[j]];
+        b[j] = a[j];
+        a[j] = c;
+      } else {
+        index_t c = a[j] ^ table[b[j]];
+        a[j] = b[j];
+        b[j] = c;
+      }
+    }
+  }
+  for (unsigned j = 0; j < 8; j++) {
+    x[j] = (a[j] << net.right_bits) | b[j];
+  }
+}
+
+template <bool inverse>
+void WalkBatch(const Network& net, index_t start, index_t count,
+                index_t* out) {
+  index_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    index_t x[8];
+    for (unsigned j = 0; j < 8; j++) {
+      x[j] = start + i + j;
+    }
+    Rounds8<inverse>(net, x);
+    // Few elements need to walk further.
+    for (unsigned j = 0; j < 8; j++) {
+      out[i + j] = x[j] < net.n ? x[j] : Walk<inverse>(net, x[j]);
+    }
+  }
+  for (; i < count; i++) {
+    out[i] = Walk<inverse>(net, start + i);
+  }
+}
+
+}  // namespace
+
+Feistel::Feistel()
+    : n_(0), left_bits_(0), right_bits_(0), tables_(nullptr), offsets_() {}
+
+void Feistel::Initialize(int seed, index_t n) {
+  unsigned bits = 0;
+  while (bits < 32 && (uint64_t(1) << bits) < n) {
+    bits++;
+  }
+  this->n_ = n;
+  this->left_bits_ = bits / 2;
+  this->right_bits_ = bits - this->left_bits_;
+
+  // Even rounds are indexed by the right half and xor into the left half,
+  // odd rounds the other way around.
+  uint32_t size = 0;
+  for (unsigned r = 0; r < FEISTEL_ROUNDS; r++) {
+    this->offsets_[r] = size;
+    size += uint32_t(1) << (r % 2 == 0 ? this->right_bits_ : this->left_bits_);
+  }
+  this->tables_ = std::make_unique<uint16_t[]>(size);
+  std::vector<uint64_t> words(size);
+  util::Stream(seed).Words(0, words.data(), size);
+  for (unsigned r = 0; r < FEISTEL_ROUNDS; r++) {
+    unsigned out_bits = r % 2 == 0 ? this->left_bits_ : this->right_bits_;
+    uint32_t end = r + 1 < FEISTEL_ROUNDS ? this->offsets_[r + 1] : size;
+    for (uint32_t i = this->offsets_[r]; i < end; i++) {
+      this->tables_[i] = words[i] & ((uint64_t(1) << out_bits) - 1);
+    }
+  }
+}
+
+void Feistel::Free() {
+  this->n_ = 0;
+  this->tables_ = nullptr;
+}
+
+index_t Feistel::Permute(index_t x) const {
+  assert(x < this->n_);
+  Network net = {this->tables_.get(), this->offsets_, this->left_bits_,
+                 this->right_bits_, this->n_};
+  return Walk<false>(net, x);
+}
+
+index_t Feistel::Invert(index_t y) const {
+  assert(y < this->n_);
+  Network net = {this->tables_.get(), this->offsets_, this->left_bits_,
+                 this->right_bits_, this->n_};
+  return Walk<true>(net, y);
+}
+
+void Feistel::Permute(index_t start, index_t count, index_t* out) const {
+  assert(start + count <= this->n_);
+  Network net = {this->tables_.get(), this->offsets_, this->left_bits_,
+                 this->right_bits_, this->n_};
+  WalkBatch<false>(net, start, count, out);
+}
+
+void Feistel::Invert(index_t start, index_t count, index_t* out) const {
+  assert(start + count <= this->n_);
+  Network net = {this->tables_.get(), this->offsets_, this->left_bits_,
+                 this->right_bits_, this->n_};
+  WalkBatch<true>(net, start, count, out);
+}
+
+}  // namespace shuffle
+}  // namespace DPPIR
@@ -0,0 +1,49 @@
+#ifndef DPPIR_SHUFFLE_FEISTEL_H_
+#define DPPIR_SHUFFLE_FEISTEL_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "DPPIR/types/types.h"
+
+// Like FF1.
+#define FEISTEL_ROUNDS 10
+
+namespace DPPIR {
+namespace shuffle {
+
+// Keyed pseudorandom permutation of [0, n), computed on the fly.
+// An (alternating, unbalanced) Feistel network over the smallest power of two
+// domain that covers n, with cycle walking to stay inside [0, n).
+// Round functions are random tables drawn from the stream of the seed (at
+// most 2^16 entries each, FEISTEL_ROUNDS * 128KB in total).
+class Feistel {
+ public:
+  Feistel();
+
+  void Initialize(int seed, index_t n);
+  void Free();
+
+  index_t Permute(index_t x) const;
+  index_t Invert(index_t y) const;
+
+  // out[i] = Permute(start + i) (resp. Invert) for i in [0, count), several
+  // elements at once.
+  void Permute(index_t start, index_t count, index_t* out) const;
+  void Invert(index_t start, index_t count, index_t* out) const;
+
+ private:
+  index_t n_;
+  // x = (left << right_bits_) | right.
+  unsigned left_bits_;
+  unsigned right_bits_;
+  // Table of round r starts at tables_ + offsets_[r], its entries are
+  // already reduced to the bits of the half they are xor-ed into.
+  std::unique_ptr<uint16_t[]> tables_;
+  uint32_t offsets_[FEISTEL_ROUNDS];
+};
+
+}  // namespace shuffle
+}  // namespace DPPIR
+
+#endif  // DPPIR_SHUFFLE_FEISTEL_H_
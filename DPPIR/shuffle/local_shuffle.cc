@@ -1,5 +1,8 @@
 #include "DPPIR/shuffle/local_shuffle.h"
 
+#include <cstring>
+
+#include "DPPIR/parallel/parallel.h"
 #include "DPPIR/shuffle/util.h"
 
 namespace DPPIR {
@@ -7,34 +10,62 @@ namespace shuffle {
 
 // Local shuffler.
 LocalShuffler::LocalShuffler(int local_seed)
-    : local_seed_(local_seed), forward_map_(nullptr), backward_map_(nullptr) {}
+    : local_seed_(local_seed),
+      implicit_(false),
+      feistel_(),
+      forward_map_(nullptr),
+      backward_map_(nullptr) {}
 
 void LocalShuffler::Initialize(index_t local_count) {
-  // Seed the random number generator.
-  util::seed(this->local_seed_);
-
-  // Create local mapping.
-  this->forward_map_ = std::make_unique<index_t[]>(local_count);
-  for (index_t i = 0; i < local_count; i++) {
-    this->forward_map_[i] = i;
+  if (this->implicit_) {
+    this->feistel_.Initialize(this->local_seed_, local_count);
+    return;
   }
 
-  // Shuffle.
-  util::shuffle(this->forward_map_.get(), local_count);
+  // Create a random local mapping.
+  this->forward_map_ = std::make_unique<index_t[]>(local_count);
+  index_t* forward = this->forward_map_.get();
+  util::Permutation(this->local_seed_, forward, local_count);
 
   // Create reverse mapping.
   this->backward_map_ = std::make_unique<index_t[]>(local_count);
-  for (index_t i = 0; i < local_count; i++) {
-    this->backward_map_[this->forward_map_[i]] = i;
-  }
+  index_t* backward = this->backward_map_.get();
+  parallel::ParallelFor(local_count, [=](unsigned, index_t s, index_t e) {
+    for (index_t i = s; i < e; i++) {
+      backward[forward[i]] = i;
+    }
+  });
 }
 
 // Online Shuffling.
-index_t LocalShuffler::Shuffle(index_t idx) { return this->forward_map_[idx]; }
+index_t LocalShuffler::Shuffle(index_t idx) {
+  if (this->implicit_) {
+    return this->feistel_.Permute(idx);
+  }
+  return this->forward_map_[idx];
+}
 index_t LocalShuffler::Deshuffle(index_t idx) {
+  if (this->implicit_) {
+    return this->feistel_.Invert(idx);
+  }
   return this->backward_map_[idx];
 }
 
+void LocalShuffler::Shuffle(index_t start, index_t count, index_t* out) {
+  if (this->implicit_) {
+    this->feistel_.Permute(start, count, out);
+  } else {
+    memcpy(out, this->forward_map_.get() + start, count * sizeof(index_t));
+  }
+}
+void LocalShuffler::Deshuffle(index_t start, index_t count, index_t* out) {
+  if (this->implicit_) {
+    this->feistel_.Invert(start, count, out);
+  } else {
+    memcpy(out, this->backward_map_.get() + start, count * sizeof(index_t));
+  }
+}
+
 // Clear maps.
 void LocalShuffler::FinishForward() { this->forward_map_ = nullptr; }
 void LocalShuffler::FinishBackward() { this->backward_map_ = nullptr; }
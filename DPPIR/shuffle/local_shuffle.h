@@ -3,6 +3,7 @@
 
 #include <memory>
 
+#include "DPPIR/shuffle/feistel.h"
 #include "DPPIR/types/types.h"
 
 namespace DPPIR {
@@ -12,11 +13,17 @@ namespace shuffle {
 class LocalShuffler {
  public:
   explicit LocalShuffler(int local_seed);
+  // Implicit shufflers compute the permutation on the fly (see Feistel)
+  // instead of storing both maps, it is a different permutation.
+  void SetImplicit(bool implicit) { this->implicit_ = implicit; }
   void Initialize(index_t local_count);
 
   // Shuffling/deshuffling.
   index_t Shuffle(index_t idx);
   index_t Deshuffle(index_t idx);
+  // out[i] = Shuffle(start + i) (resp. Deshuffle) for i in [0, count).
+  void Shuffle(index_t start, index_t count, index_t* out);
+  void Deshuffle(index_t start, index_t count, index_t* out);
 
   // Clear maps.
   void FinishForward();
@@ -24,6 +31,8 @@ class LocalShuffler {
 
  private:
   int local_seed_;
+  bool implicit_;
+  Feistel feistel_;
   // Shuffling maps.
   std::unique_ptr<index_t[]> forward_map_;
   std::unique_ptr<index_t[]> backward_map_;
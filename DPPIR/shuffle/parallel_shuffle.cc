@@ -1,5 +1,7 @@
 #include "DPPIR/shuffle/parallel_shuffle.h"
 
+#include <vector>
+
 #include "DPPIR/shuffle/util.h"
 
 namespace DPPIR {
@@ -7,10 +9,12 @@ namespace shuffle {
 
 // ParallelShuffler.
 ParallelShuffler::ParallelShuffler(server_id_t server_id,
-                                   server_id_t server_count, int shared_seed)
+                                   server_id_t server_count, int shared_seed,
+                                   const std::vector<index_t>& weights)
     : shared_seed_(shared_seed),
       server_id_(server_id),
       server_count_(server_count),
+      weights_(weights),
       slice_size_(0),
       forward_map_(nullptr),
       backward_map_(nullptr),
@@ -32,11 +36,9 @@ void ParallelShuffler::Initialize(const index_t* server_counts,
   }
 
   // How many element this server should get.
-  index_t per_server = total_count / this->server_count_;
-  this->slice_size_ = per_server;
-  if (this->server_id_ == this->server_count_ - 1) {
-    this->slice_size_ = total_count - (this->server_count_ - 1) * per_server;
-  }
+  auto slice = WeightedRange(this->server_id_, this->server_count_,
+                             this->weights_, total_count);
+  this->slice_size_ = slice.second - slice.first;
 
   // Allocate space.
   this->backward_idx_ = std::make_unique<index_t[]>(this->server_count_);
@@ -59,46 +61,54 @@ void ParallelShuffler::Initialize(const index_t* server_counts,
     this->backward_idx_[sid] = 0;
   }
 
-  // Create global mapping of messages to servers (initially identity).
-  auto map = std::make_unique<server_id_t[]>(total_count);
+  // Shuffling the batch assigns every message of a source server to a target
+  // server, such that every target gets its slice size. Instead of shuffling
+  // a map of the whole batch, sample how many messages go from every source
+  // to every target (multivariate hypergeometric: every source draws its
+  // count from the remaining slots of the targets), and then shuffle the
+  // targets of the messages of this server.
+  // All servers sample the same counts from words [0, ...) of the shared
+  // stream, server i shuffles with words [(i + 1) << 40, ...).
+  std::vector<index_t> slots(this->server_count_);
   for (server_id_t sid = 0; sid < this->server_count_; sid++) {
-    index_t start = sid * per_server;
-    index_t end = start + per_server;
-    if (sid == this->server_count_ - 1) {
-      end = total_count;
+    auto range =
+        WeightedRange(sid, this->server_count_, this->weights_, total_count);
+    slots[sid] = range.second - range.first;
+  }
+  util::Stream stream(this->shared_seed_);
+  util::StreamReader reader(stream, 0);
+  for (server_id_t source = 0; source < this->server_count_; source++) {
+    index_t left = server_counts[source];
+    index_t pool = 0;
+    for (server_id_t target = 0; target < this->server_count_; target++) {
+      pool += slots[target];
     }
-    for (index_t i = start; i < end; i++) {
-      map[i] = sid;
+    for (server_id_t target = 0; target < this->server_count_; target++) {
+      pool -= slots[target];
+      index_t count = util::Hypergeometric(&reader, slots[target], pool, left);
+      slots[target] -= count;
+      left -= count;
+      if (target == this->server_id_) {
+        this->from_count_[source] = count;
+      }
+      if (source == this->server_id_) {
+        this->to_count_[target] = count;
+      }
     }
   }
 
-  // Shuffle mapping.
-  util::seed(this->shared_seed_);
-  util::shuffle(map.get(), total_count);
-
-  // Find how many messages will be sent to/from this server.
-  // Tirm down map to this server section to compute forward_map_.
-  server_id_t source = 0;
-  index_t start_idx = 0;
-  for (index_t idx = 0; idx < total_count; idx++) {
-    while (idx - start_idx >= server_counts[source]) {
-      start_idx += server_counts[source];
-      source++;
-    }
-
-    server_id_t target = map[idx];
-    // count messages sent to this server.
-    if (target == this->server_id_) {
-      this->from_count_[source]++;
-    }
-    if (source == this->server_id_) {
-      if (idx - start_idx < noise_count) {
-        this->to_noise_count_[target]++;
-      }
-      this->to_count_[target]++;
-      this->forward_map_[idx - start_idx] = target;
+  // Targets of the messages of this server.
+  index_t idx = 0;
+  for (server_id_t target = 0; target < this->server_count_; target++) {
+    for (index_t i = 0; i < this->to_count_[target]; i++) {
+      this->forward_map_[idx++] = target;
     }
   }
+  util::shuffle(this->forward_map_.get(), idx, this->shared_seed_,
+                static_cast<uint64_t>(this->server_id_ + 1) << 40);
+  for (index_t i = 0; i < noise_count; i++) {
+    this->to_noise_count_[this->forward_map_[i]]++;
+  }
 
   // Allocate the exact space needed for backward_map_.
   for (server_id_t sid = 0; sid < this->server_count_; sid++) {
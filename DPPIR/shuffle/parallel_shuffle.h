@@ -2,6 +2,7 @@
 #define DPPIR_SHUFFLE_PARALLEL_SHUFFLE_H_
 
 #include <memory>
+#include <vector>
 
 #include "DPPIR/types/types.h"
 
@@ -9,10 +10,12 @@ namespace DPPIR {
 namespace shuffle {
 
 // Parallel shuffler.
+// Every server gets a slice of the shuffled batch proportional to its weight
+// (see WeightedRange()), or an equal slice if weights is empty.
 class ParallelShuffler {
  public:
   ParallelShuffler(server_id_t server_id, server_id_t server_count,
-                   int shared_seed);
+                   int shared_seed, const std::vector<index_t>& weights = {});
   void Initialize(const index_t* server_counts, index_t noise_count);
 
   // Shuffling/deshuffling.
@@ -39,6 +42,7 @@ class ParallelShuffler {
   int shared_seed_;
   server_id_t server_id_;
   server_id_t server_count_;
+  std::vector<index_t> weights_;
   index_t slice_size_;
   // Shuffling maps.
   std::unique_ptr<server_id_t[]> forward_map_;
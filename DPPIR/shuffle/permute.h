@@ -0,0 +1,159 @@
+#ifndef DPPIR_SHUFFLE_PERMUTE_H_
+#define DPPIR_SHUFFLE_PERMUTE_H_
+
+#include <memory>
+#include <vector>
+
+#include "DPPIR/parallel/parallel.h"
+#include "DPPIR/types/types.h"
+
+// Bytes of records scattered within cache at once by Permuter::Finish().
+#define PERMUTE_BLOCK_SIZE (1 << 18)
+// Max number of groups a pass of Permuter scatters to (bits).
+#define PERMUTE_FANOUT_BITS 8
+
+namespace DPPIR {
+namespace shuffle {
+
+// Applies a permutation to a batch, i.e. writes every pushed element v to
+// out[target], in a few cache friendly passes instead of one random write
+// per element.
+// Elements are first appended to one of a few coarse groups by the high bits
+// of their target (as they are pushed), groups are then split into blocks of
+// PERMUTE_BLOCK_SIZE bytes, and every block is scattered to its part of out
+// within cache.
+// Needs count * (sizeof(T) + sizeof(index_t)) bytes until Finish(), and
+// about 1/2^PERMUTE_FANOUT_BITS of that per thread during Finish().
+template <typename T>
+class Permuter {
+ public:
+  Permuter()
+      : records_(nullptr),
+        heads_(),
+        count_(0),
+        coarse_shift_(0),
+        fine_shift_(0) {}
+
+  // out has count elements, targets are unique.
+  void Initialize(index_t count) {
+    unsigned bits = 0;
+    while (bits < 32 && (index_t(1) << bits) < count) {
+      bits++;
+    }
+    this->fine_shift_ = 0;
+    while ((sizeof(Record) << (this->fine_shift_ + 1)) <= PERMUTE_BLOCK_SIZE) {
+      this->fine_shift_++;
+    }
+    this->coarse_shift_ = this->fine_shift_;
+    if (bits > this->fine_shift_ + PERMUTE_FANOUT_BITS) {
+      this->coarse_shift_ = bits - PERMUTE_FANOUT_BITS;
+    }
+    // Group g holds targets [g << coarse_shift_, (g + 1) << coarse_shift_),
+    // and is stored at the same range of records_.
+    this->count_ = count;
+    this->records_ = std::make_unique<Record[]>(count);
+    index_t groups = 0;
+    if (count > 0) {
+      groups = ((count - 1) >> this->coarse_shift_) + 1;
+    }
+    this->heads_.resize(groups);
+    for (index_t g = 0; g < groups; g++) {
+      this->heads_[g] = g << this->coarse_shift_;
+    }
+  }
+  void Free() {
+    this->records_ = nullptr;
+    this->heads_.clear();
+    this->heads_.shrink_to_fit();
+    this->count_ = 0;
+  }
+
+  // First pass.
+  inline void Push(const T& v, index_t target) {
+    index_t group = target >> this->coarse_shift_;
+    Record& record = this->records_[this->heads_[group]++];
+    record.target = target;
+    record.value = v;
+  }
+
+  // Remaining passes (in parallel), writes all pushed elements to out and
+  // frees memory. Other elements of out are left as is.
+  void Finish(T* out) {
+    Record* records = this->records_.get();
+    const index_t* heads = this->heads_.data();
+    index_t count = this->count_;
+    unsigned coarse = this->coarse_shift_;
+    unsigned fine = this->fine_shift_;
+    index_t groups = this->heads_.size();
+    parallel::ParallelFor(groups, [=](unsigned, index_t s, index_t e) {
+      std::unique_ptr<Record[]> scratch = nullptr;
+      if (coarse > fine) {
+        scratch = std::unique_ptr<Record[]>(new Record[index_t(1) << coarse]);
+      }
+      for (index_t g = s; g < e; g++) {
+        index_t start = g << coarse;
+        index_t size = count - start;
+        if (size > (index_t(1) << coarse)) {
+          size = index_t(1) << coarse;
+        }
+        Split(records + start, heads[g] - start, start, size, coarse, fine,
+              scratch.get(), out);
+      }
+    });
+    this->Free();
+  }
+
+ private:
+  struct Record {
+    index_t target;
+    T value;
+  };
+
+  // in has count records with targets in [base, base + size), size is at
+  // most 2^shift. Splits them into scratch (also of size) by the next bits of
+  // their target, and recursively splits every part using the same part of in
+  // as scratch, until parts fit in a block.
+  static void Split(Record* in, index_t count, index_t base, index_t size,
+                    unsigned shift, unsigned fine, Record* scratch, T* out) {
+    if (shift <= fine) {
+      for (Record* r = in; r < in + count; r++) {
+        out[r->target] = r->value;
+      }
+      return;
+    }
+    unsigned next = fine;
+    if (shift > fine + PERMUTE_FANOUT_BITS) {
+      next = shift - PERMUTE_FANOUT_BITS;
+    }
+    std::vector<index_t> heads(index_t(1) << (shift - next));
+    for (index_t b = 0; b < heads.size(); b++) {
+      heads[b] = b << next;
+    }
+    for (Record* r = in; r < in + count; r++) {
+      scratch[heads[(r->target - base) >> next]++] = *r;
+    }
+    for (index_t b = 0; b < heads.size(); b++) {
+      index_t start = b << next;
+      if (start >= size) {
+        break;
+      }
+      index_t part = size - start;
+      if (part > (index_t(1) << next)) {
+        part = index_t(1) << next;
+      }
+      Split(scratch + start, heads[b] - start, base + start, part, next, fine,
+            in + start, out);
+    }
+  }
+
+  std::unique_ptr<Record[]> records_;
+  std::vector<index_t> heads_;  // Next free record of every group.
+  index_t count_;
+  unsigned coarse_shift_;
+  unsigned fine_shift_;
+};
+
+}  // namespace shuffle
+}  // namespace DPPIR
+
+#endif  // DPPIR_SHUFFLE_PERMUTE_H_
@@ -0,0 +1,233 @@
+// Measures the shuffle engines as a function of the batch size: generating
+// local permutations (stored maps and implicit Feistel), applying them to
+// batches of queries and responses (scattering one element at a time, and
+// blocked with Permuter), and initializing ParallelShuffler for several
+// numbers of servers. Reports ns/element and GB/s.
+//
+// Usage: shuffle_benchmark [--min=<n>] [--max=<n>] [--servers=<s1,s2,...>]
+//                          [--threads=<n>]
+// Sizes go from min to max (1M to 1B by default) by factors of 10, sizes that
+// do not fit in memory are skipped.
+// --threads=0 (the default) uses all cores.
+
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+// NOLINTNEXTLINE
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "DPPIR/parallel/parallel.h"
+#include "DPPIR/shuffle/local_shuffle.h"
+#include "DPPIR/shuffle/parallel_shuffle.h"
+#include "DPPIR/shuffle/permute.h"
+#include "DPPIR/types/containers.h"
+#include "DPPIR/types/types.h"
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+// Targets computed at once, like a network chunk.
+#define CHUNK_SIZE 4096
+// Peak memory per element: maps, input and output responses, and Permuter.
+#define BYTES_PER_ELEMENT \
+  (3 * sizeof(DPPIR::index_t) + 3 * sizeof(DPPIR::Response))
+
+namespace DPPIR {
+namespace shuffle {
+
+using micros = std::chrono::microseconds;
+
+template <typename F>
+double Time(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<micros>(end - start).count();
+}
+
+// Prints ns/element and GB/s (of bytes produced or moved).
+void Report(const char* label, uint64_t count, uint64_t bytes, double us) {
+  double seconds = us / 1000000.0;
+  std::cout << "  " << label << ": " << us * 1000 / count << " ns/element, "
+            << bytes / seconds / 1e9 << " GB/s" << std::endl;
+}
+
+// out[Shuffle(i)] = in[i] (resp. Deshuffle) one element at a time.
+template <typename T>
+void Scatter(LocalShuffler* shuffler, bool forward, Batch<T>* in,
+             Batch<T>* out, index_t n) {
+  std::vector<index_t> targets(CHUNK_SIZE);
+  for (index_t i = 0; i < n; i += CHUNK_SIZE) {
+    index_t count = n - i < CHUNK_SIZE ? n - i : CHUNK_SIZE;
+    if (forward) {
+      shuffler->Shuffle(i, count, targets.data());
+    } else {
+      shuffler->Deshuffle(i, count, targets.data());
+    }
+    for (index_t j = 0; j < count; j++) {
+      (*out)[targets[j]] = (*in)[i + j];
+    }
+  }
+}
+
+// Same, with Permuter (including its allocation, as parties do).
+template <typename T>
+void Blocked(LocalShuffler* shuffler, bool forward, Batch<T>* in,
+             Batch<T>* out, index_t n) {
+  Permuter<T> permuter;
+  permuter.Initialize(n);
+  std::vector<index_t> targets(CHUNK_SIZE);
+  for (index_t i = 0; i < n; i += CHUNK_SIZE) {
+    index_t count = n - i < CHUNK_SIZE ? n - i : CHUNK_SIZE;
+    if (forward) {
+      shuffler->Shuffle(i, count, targets.data());
+    } else {
+      shuffler->Deshuffle(i, count, targets.data());
+    }
+    for (index_t j = 0; j < count; j++) {
+      permuter.Push((*in)[i + j], targets[j]);
+    }
+  }
+  permuter.Finish(out->begin());
+}
+
+template <typename T>
+void Apply(const char* name, LocalShuffler* shuffler, const char* engine,
+           index_t n) {
+  Batch<T> in;
+  Batch<T> out;
+  in.Initialize(n);
+  out.Initialize(n);
+  randombytes_buf(in.begin(), n * sizeof(T));
+  uint64_t bytes = static_cast<uint64_t>(n) * sizeof(T);
+
+  std::string label = std::string(engine) + " shuffle " + name;
+  Report(label.c_str(), n, bytes,
+         Time([&]() { Scatter(shuffler, true, &in, &out, n); }));
+  label = std::string(engine) + " deshuffle " + name;
+  Report(label.c_str(), n, bytes,
+         Time([&]() { Scatter(shuffler, false, &in, &out, n); }));
+  label = std::string(engine) + " blocked shuffle " + name;
+  Report(label.c_str(), n, bytes,
+         Time([&]() { Blocked(shuffler, true, &in, &out, n); }));
+  label = std::string(engine) + " blocked deshuffle " + name;
+  Report(label.c_str(), n, bytes,
+         Time([&]() { Blocked(shuffler, false, &in, &out, n); }));
+}
+
+void BenchmarkLocal(index_t n) {
+  for (bool implicit : {false, true}) {
+    const char* engine = implicit ? "implicit" : "maps";
+    LocalShuffler shuffler(1);
+    shuffler.SetImplicit(implicit);
+    std::string label = std::string(engine) + " initialize";
+    Report(label.c_str(), n, static_cast<uint64_t>(n) * sizeof(index_t),
+           Time([&]() { shuffler.Initialize(n); }));
+    Apply<Query>("queries", &shuffler, engine, n);
+    Apply<Response>("responses", &shuffler, engine, n);
+  }
+}
+
+void BenchmarkParallel(index_t n, const std::vector<server_id_t>& servers) {
+  for (server_id_t count : servers) {
+    // Equal inputs, noise is 1% of every input.
+    std::vector<index_t> counts(count, n / count);
+    counts[0] += n % count;
+    ParallelShuffler shuffler(0, count, 1);
+    std::string label =
+        "parallel initialize (" + std::to_string(count) + " servers)";
+    double us = Time(
+        [&]() { shuffler.Initialize(counts.data(), counts[0] / 100); });
+    Report(label.c_str(), counts[0],
+           static_cast<uint64_t>(counts[0]) * sizeof(server_id_t), us);
+  }
+}
+
+// Parses a decimal number in [1, limit] that makes up all of str.
+bool ParseNumber(const std::string& str, uint64_t limit, uint64_t* n) {
+  if (str.empty() || str[0] < '0' || str[0] > '9') {
+    return false;
+  }
+  char* rest;
+  errno = 0;
+  *n = std::strtoull(str.c_str(), &rest, 10);
+  return *rest == '\0' && errno == 0 && *n > 0 && *n <= limit;
+}
+
+}  // namespace shuffle
+}  // namespace DPPIR
+
+int main(int argc, char** argv) {
+  assert(sodium_init() >= 0);
+
+  // Parse flags.
+  uint64_t min = 1000000;
+  uint64_t max = 1000000000;
+  std::vector<DPPIR::server_id_t> servers = {2, 4, 8, 16};
+  uint64_t threads = 0;
+  bool usage = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.rfind("--min=", 0) == 0) {
+      usage |= !DPPIR::shuffle::ParseNumber(arg.substr(strlen("--min=")),
+                                            UINT32_MAX, &min);
+    } else if (arg.rfind("--max=", 0) == 0) {
+      usage |= !DPPIR::shuffle::ParseNumber(arg.substr(strlen("--max=")),
+                                            UINT32_MAX, &max);
+    } else if (arg.rfind("--servers=", 0) == 0) {
+      servers.clear();
+      std::string list = arg.substr(strlen("--servers="));
+      size_t start = 0;
+      while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+          end = list.size();
+        }
+        std::string token = list.substr(start, end - start);
+        uint64_t count;
+        if (!token.empty()) {
+          usage |= !DPPIR::shuffle::ParseNumber(
+              token, std::numeric_limits<DPPIR::server_id_t>::max(), &count);
+          servers.push_back(count);
+        }
+        start = end + 1;
+      }
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      std::string value = arg.substr(strlen("--threads="));
+      usage |= value != "0" &&
+               !DPPIR::shuffle::ParseNumber(value, UINT16_MAX, &threads);
+    } else {
+      usage = true;
+    }
+  }
+  if (usage || servers.empty() || min > max) {
+    std::cout << "Usage: " << argv[0]
+              << " [--min=<n>] [--max=<n>] [--servers=<s1,s2,...>]"
+              << " [--threads=<n>]" << std::endl;
+    return 1;
+  }
+  if (threads > 0) {
+    DPPIR::parallel::SetThreadCount(threads);
+  }
+  std::cout << "Using " << DPPIR::parallel::ThreadCount() << " threads"
+            << std::endl;
+
+  uint64_t memory = sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+  for (uint64_t n = min; n <= max; n *= 10) {
+    if (n * BYTES_PER_ELEMENT > memory) {
+      std::cout << n << " elements: skipped, needs "
+                << n * BYTES_PER_ELEMENT / (1 << 20) << " MiB" << std::endl;
+      continue;
+    }
+    std::cout << n << " elements:" << std::endl;
+    DPPIR::shuffle::BenchmarkLocal(n);
+    DPPIR::shuffle::BenchmarkParallel(n, servers);
+  }
+  return 0;
+}
@@ -2,11 +2,15 @@
 // NOLINTNEXTLINE
 #include <chrono>
 #include <iostream>
+#include <map>
 #include <string>
 #include <vector>
 
+#include "DPPIR/parallel/parallel.h"
 #include "DPPIR/shuffle/local_shuffle.h"
 #include "DPPIR/shuffle/parallel_shuffle.h"
+#include "DPPIR/shuffle/permute.h"
+#include "DPPIR/shuffle/util.h"
 #include "DPPIR/types/types.h"
 
 #define SERVER_COUNT 8
@@ -84,9 +88,10 @@ struct Server {
   std::vector<key_t> outputs;
 
   // Constructor.
-  Server(server_id_t sid, index_t* server_counts)
+  Server(server_id_t sid, index_t* server_counts,
+         const std::vector<index_t>& weights)
       : id(sid),
-        pshuffler(sid, SERVER_COUNT, SERVER_COUNT),
+        pshuffler(sid, SERVER_COUNT, SERVER_COUNT, weights),
         lshuffler(sid),
         forward_from_servers(SERVER_COUNT, std::vector<key_t>()),
         backward_from_servers(SERVER_COUNT, std::vector<key_t>()) {
@@ -133,7 +138,7 @@ void SingleOffline() {
   std::cout << std::endl;
 }
 
-bool SimpleProtocol() {
+bool SimpleProtocol(const std::vector<index_t>& weights) {
   // Give every server an input size.
   std::vector<index_t> input_counts;
   for (server_id_t sid = 0; sid < SERVER_COUNT; sid++) {
@@ -144,7 +149,28 @@ bool SimpleProtocol() {
   std::vector<Server> servers;
   servers.reserve(SERVER_COUNT);
   for (server_id_t sid = 0; sid < SERVER_COUNT; sid++) {
-    servers.emplace_back(sid, &input_counts.at(0));
+    servers.emplace_back(sid, &input_counts.at(0), weights);
+  }
+
+  // Slices must cover the batch, proportionally to the weights.
+  index_t total_weight = weights.empty() ? SERVER_COUNT : 0;
+  for (index_t weight : weights) {
+    total_weight += weight;
+  }
+  index_t total_slices = 0;
+  for (auto& server : servers) {
+    index_t weight = weights.empty() ? 1 : weights.at(server.id);
+    index_t expected = TOTAL_COUNT / total_weight * weight;
+    index_t slice = server.pshuffler.GetServerSliceSize();
+    if (slice + weight + 1 < expected || slice > expected + weight + 1) {
+      std::cout << "Bad slice size " << slice << std::endl;
+      return false;
+    }
+    total_slices += slice;
+  }
+  if (total_slices != TOTAL_COUNT) {
+    std::cout << "Slices do not cover the batch" << std::endl;
+    return false;
   }
 
   // First stage.
@@ -228,6 +254,147 @@ bool SimpleProtocol() {
   return true;
 }
 
+// The permutation only depends on the seed, not on the number of threads.
+bool Deterministic() {
+  index_t count = 300000;
+  std::vector<std::vector<index_t>> permutations;
+  for (unsigned threads : {1, 3}) {
+    for (int seed : {5, 6}) {
+      parallel::SetThreadCount(threads);
+      LocalShuffler shuffler(seed);
+      shuffler.Initialize(count);
+      std::vector<index_t> permutation;
+      for (index_t i = 0; i < count; i++) {
+        permutation.push_back(shuffler.Shuffle(i));
+        if (shuffler.Deshuffle(permutation.back()) != i) {
+          return false;
+        }
+      }
+      permutations.push_back(permutation);
+    }
+  }
+  return permutations[0] == permutations[2] &&
+         permutations[1] == permutations[3] &&
+         permutations[0] != permutations[1];
+}
+
+// Every permutation of a small array is equally likely, also when elements
+// are spread over several buckets.
+bool Uniform() {
+  const int runs = 24000;
+  std::map<std::vector<index_t>, int> counts;
+  for (int seed = 0; seed < runs; seed++) {
+    std::vector<index_t> permutation(4);
+    util::Permutation(seed, permutation.data(), 4, 2);
+    counts[permutation]++;
+  }
+  if (counts.size() != 24) {
+    return false;
+  }
+  for (const auto& [permutation, count] : counts) {
+    if (count < runs / 24 * 0.85 || count > runs / 24 * 1.15) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Servers agree on how many messages they exchange, and these counts follow
+// the distribution of shuffling the whole batch.
+bool Counts() {
+  // Two servers with 2 messages each, P(server 0 keeps k) = 1/6, 4/6, 1/6.
+  const int runs = 6000;
+  int kept[3] = {0, 0, 0};
+  index_t counts[2] = {2, 2};
+  for (int seed = 0; seed < runs; seed++) {
+    ParallelShuffler server0(0, 2, seed);
+    ParallelShuffler server1(1, 2, seed);
+    server0.Initialize(counts, 0);
+    server1.Initialize(counts, 0);
+    if (server0.CountToServer(1) != server1.CountFromServer(0) ||
+        server1.CountToServer(0) != server0.CountFromServer(1)) {
+      return false;
+    }
+    kept[server0.CountToServer(0)]++;
+  }
+  const int expected[3] = {runs / 6, runs * 4 / 6, runs / 6};
+  for (int k = 0; k < 3; k++) {
+    if (kept[k] < expected[k] * 0.9 || kept[k] > expected[k] * 1.1) {
+      return false;
+    }
+  }
+
+  // Large counts: mean 25000 and standard deviation ~135.
+  util::Stream stream(1);
+  util::StreamReader reader(stream, 0);
+  double sum = 0;
+  for (int i = 0; i < 1000; i++) {
+    sum += util::Hypergeometric(&reader, 1000000, 3000000, 100000);
+  }
+  return sum / 1000 > 24980 && sum / 1000 < 25020;
+}
+
+// Implicit shufflers are permutations, deshuffling inverts them, and batches
+// match single elements.
+bool Implicit() {
+  for (index_t count : {1, 2, 3, 1000, 65536, 100003}) {
+    LocalShuffler shuffler(7);
+    shuffler.SetImplicit(true);
+    shuffler.Initialize(count);
+    std::vector<index_t> forward(count);
+    std::vector<index_t> backward(count);
+    shuffler.Shuffle(0, count, forward.data());
+    shuffler.Deshuffle(0, count, backward.data());
+    std::vector<bool> seen(count, false);
+    for (index_t i = 0; i < count; i++) {
+      index_t target = forward[i];
+      if (target >= count || seen[target] || backward[target] != i ||
+          shuffler.Shuffle(i) != target || shuffler.Deshuffle(target) != i) {
+        return false;
+      }
+      seen[target] = true;
+    }
+  }
+  // Keyed by the seed.
+  std::vector<std::vector<index_t>> permutations;
+  for (int seed : {5, 6, 5}) {
+    LocalShuffler shuffler(seed);
+    shuffler.SetImplicit(true);
+    shuffler.Initialize(1000);
+    permutations.emplace_back(1000);
+    shuffler.Shuffle(0, 1000, permutations.back().data());
+  }
+  return permutations[0] != permutations[1] &&
+         permutations[0] == permutations[2];
+}
+
+// Permuter puts every pushed element where a plain scatter does, and leaves
+// the other elements as is.
+bool Blocked() {
+  for (index_t count : {1, 1000, 5000000}) {
+    LocalShuffler shuffler(count);
+    shuffler.Initialize(count);
+    std::vector<Query> expected(count, {0, 0});
+    std::vector<Query> actual(count, {0, 0});
+    Permuter<Query> permuter;
+    permuter.Initialize(count);
+    // Skip the first few elements, like parties skip their noise.
+    for (index_t i = count / 10; i < count; i++) {
+      Query query = {i, i + 1};
+      expected[shuffler.Shuffle(i)] = query;
+      permuter.Push(query, shuffler.Shuffle(i));
+    }
+    permuter.Finish(actual.data());
+    for (index_t i = 0; i < count; i++) {
+      if (actual[i].tag != expected[i].tag ||
+          actual[i].tally != expected[i].tally) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 }  // namespace shuffle
 }  // namespace DPPIR
 
@@ -240,7 +407,45 @@ int main(int argc, char** argv) {
   DPPIR::shuffle::SingleOffline();
 
   // Protocol.
-  if (!DPPIR::shuffle::SimpleProtocol()) {
+  if (!DPPIR::shuffle::SimpleProtocol({})) {
+    std::cout << "error!" << std::endl;
+    return 1;
+  }
+
+  // Uniformity and determinism.
+  if (!DPPIR::shuffle::Uniform()) {
+    std::cout << "Permutations are not uniform!" << std::endl;
+    return 1;
+  }
+  if (!DPPIR::shuffle::Deterministic()) {
+    std::cout << "Shuffling is not deterministic!" << std::endl;
+    return 1;
+  }
+
+  // Parallel shuffle counts.
+  if (!DPPIR::shuffle::Counts()) {
+    std::cout << "Parallel shuffle counts are wrong!" << std::endl;
+    return 1;
+  }
+
+  // Implicit shuffling.
+  if (!DPPIR::shuffle::Implicit()) {
+    std::cout << "Implicit shuffling is wrong!" << std::endl;
+    return 1;
+  }
+
+  // Blocked permutations.
+  if (!DPPIR::shuffle::Blocked()) {
+    std::cout << "Blocked permutation is wrong!" << std::endl;
+    return 1;
+  }
+
+  // Protocol with heterogeneous servers.
+  std::vector<DPPIR::index_t> weights;
+  for (int i = 0; i < SERVER_COUNT; i++) {
+    weights.push_back(1 + i % 3);
+  }
+  if (!DPPIR::shuffle::SimpleProtocol(weights)) {
     std::cout << "error!" << std::endl;
     return 1;
   }
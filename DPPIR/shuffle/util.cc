@@ -1,17 +1,264 @@
 #include "DPPIR/shuffle/util.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "DPPIR/parallel/parallel.h"
+
 namespace DPPIR {
 namespace shuffle {
 namespace util {
 
-void seed(int s) { srand(s); }
+// 8 words per 64 byte ChaCha20 block.
+#define WORDS_PER_BLOCK 8
+static_assert(STREAM_CHUNK_WORDS % WORDS_PER_BLOCK == 0);
+
+namespace {
+
+// Uniform in [0, bound) from a random word (bias below 2^-32).
+inline index_t Bounded(uint64_t word, uint64_t bound) {
+  return (word * static_cast<unsigned __int128>(bound)) >> 64;
+}
+
+// Calls f(i, bucket of i) for i in [s, e).
+template <typename F>
+void ForEachBucket(const Stream& stream, uint64_t buckets, index_t s,
+                   index_t e, F f) {
+  uint64_t words[STREAM_CHUNK_WORDS];
+  for (index_t i = s; i < e; i += STREAM_CHUNK_WORDS) {
+    index_t count = e - i;
+    if (count > STREAM_CHUNK_WORDS) {
+      count = STREAM_CHUNK_WORDS;
+    }
+    stream.Words(i, words, count);
+    for (index_t j = 0; j < count; j++) {
+      f(i + j, Bounded(words[j], buckets));
+    }
+  }
+}
+
+}  // namespace
+
+Stream::Stream(int seed) : key_() {
+  crypto_generichash(this->key_, sizeof(this->key_),
+                     reinterpret_cast<const unsigned char*>(&seed),
+                     sizeof(seed), nullptr, 0);
+}
+
+void Stream::Words(uint64_t start, uint64_t* out, size_t count) const {
+  static const unsigned char zeros[STREAM_CHUNK_WORDS * sizeof(uint64_t)] = {};
+  static const unsigned char nonce[crypto_stream_chacha20_NONCEBYTES] = {};
+  uint64_t buffer[STREAM_CHUNK_WORDS];
+  // The block counter of ChaCha20 gives random access to the stream.
+  uint64_t block = start / WORDS_PER_BLOCK;
+  size_t skip = start % WORDS_PER_BLOCK;
+  while (count > 0) {
+    size_t words = skip + count;
+    if (words > STREAM_CHUNK_WORDS) {
+      words = STREAM_CHUNK_WORDS;
+    }
+    size_t blocks = (words + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK;
+    crypto_stream_chacha20_xor_ic(reinterpret_cast<unsigned char*>(buffer),
+                                  zeros, blocks * WORDS_PER_BLOCK * 8, nonce,
+                                  block, this->key_);
+    size_t n = words - skip;
+    memcpy(out, buffer + skip, n * sizeof(uint64_t));
+    out += n;
+    count -= n;
+    block += blocks;
+    skip = 0;
+  }
+}
+
+// StreamReader.
+StreamReader::StreamReader(const Stream& stream, uint64_t start)
+    : stream_(stream), next_(start), buffered_(false), buffer_() {}
+
+uint64_t StreamReader::Next() {
+  size_t idx = this->next_ % WORDS_PER_BLOCK;
+  if (idx == 0 || !this->buffered_) {
+    this->stream_.Words(this->next_ - idx, this->buffer_, WORDS_PER_BLOCK);
+    this->buffered_ = true;
+  }
+  this->next_++;
+  return this->buffer_[idx];
+}
+
+double StreamReader::NextDouble() {
+  return (this->Next() >> 11) * 0x1.0p-53;
+}
+
+// Same as numpy's random_hypergeometric(): simulates the draws for small
+// samples, and uses the ratio of uniforms method of Stadlober (HRUA)
+// otherwise.
+namespace {
+
+double LogFactorial(uint64_t k) { return std::lgamma(k + 1.0); }
+
+uint64_t HypergeometricSample(StreamReader* reader, uint64_t good,
+                              uint64_t bad, uint64_t sample) {
+  uint64_t total = good + bad;
+  uint64_t computed_sample = sample > total / 2 ? total - sample : sample;
+  uint64_t remaining_total = total;
+  uint64_t remaining_good = good;
+  while (computed_sample > 0 && remaining_good > 0 &&
+         remaining_total > remaining_good) {
+    if (Bounded(reader->Next(), remaining_total) < remaining_good) {
+      remaining_good--;
+    }
+    remaining_total--;
+    computed_sample--;
+  }
+  if (remaining_total == remaining_good) {
+    remaining_good -= computed_sample;
+  }
+  return sample > total / 2 ? remaining_good : good - remaining_good;
+}
+
+uint64_t HypergeometricHRUA(StreamReader* reader, uint64_t good, uint64_t bad,
+                            uint64_t sample) {
+  const double d1 = 1.7155277699214135;
+  const double d2 = 0.8989161620588988;
+  uint64_t popsize = good + bad;
+  uint64_t computed_sample = std::min(sample, popsize - sample);
+  uint64_t mingoodbad = std::min(good, bad);
+  uint64_t maxgoodbad = std::max(good, bad);
+
+  double p = static_cast<double>(mingoodbad) / popsize;
+  double q = static_cast<double>(maxgoodbad) / popsize;
+  double a = computed_sample * p + 0.5;
+  double var = static_cast<double>(popsize - computed_sample) *
+               computed_sample * p * q / (popsize - 1);
+  double c = std::sqrt(var + 0.5);
+  double h = d1 * c + d2;
+  uint64_t m = std::floor(static_cast<double>(computed_sample + 1) *
+                          (mingoodbad + 1) / (popsize + 2));
+  double g = LogFactorial(m) + LogFactorial(mingoodbad - m) +
+             LogFactorial(computed_sample - m) +
+             LogFactorial(maxgoodbad - computed_sample + m);
+  double b = std::min<double>(std::min(computed_sample, mingoodbad) + 1,
+                              std::floor(a + 16 * c));
+
+  uint64_t k;
+  while (true) {
+    double u = reader->NextDouble();
+    double v = reader->NextDouble();
+    double x = a + h * (v - 0.5) / u;
+    // Fast rejection.
+    if (x < 0.0 || x >= b) {
+      continue;
+    }
+    k = std::floor(x);
+    double t = g - (LogFactorial(k) + LogFactorial(mingoodbad - k) +
+                    LogFactorial(computed_sample - k) +
+                    LogFactorial(maxgoodbad - computed_sample + k));
+    // Fast acceptance.
+    if (u * (4.0 - u) - 3.0 <= t) {
+      break;
+    }
+    // Fast rejection.
+    if (u * (u - t) >= 1) {
+      continue;
+    }
+    if (2.0 * std::log(u) <= t) {
+      break;
+    }
+  }
+  if (good > bad) {
+    k = computed_sample - k;
+  }
+  if (computed_sample < sample) {
+    k = good - k;
+  }
+  return k;
+}
+
+}  // namespace
+
+uint64_t Hypergeometric(StreamReader* reader, uint64_t good, uint64_t bad,
+                        uint64_t sample) {
+  assert(sample <= good + bad);
+  if (sample >= 10 && sample + 10 <= good + bad) {
+    return HypergeometricHRUA(reader, good, bad, sample);
+  }
+  return HypergeometricSample(reader, good, bad, sample);
+}
 
 // https://lemire.me/blog/2016/06/30/fast-random-shuffling/
-uint32_t random_bounded(uint32_t range) {
-  // NOLINTNEXTLINE
-  uint64_t random32bit = static_cast<uint32_t>(rand());  // 32-bit random number
-  uint64_t multiresult = random32bit * range;
-  return multiresult >> 32;
+void SampleSwaps(int seed, index_t* swaps, index_t n, uint64_t offset) {
+  Stream stream(seed);
+  parallel::ParallelFor(n, [&](unsigned, index_t s, index_t e) {
+    uint64_t words[STREAM_CHUNK_WORDS];
+    for (index_t i = s; i < e; i += STREAM_CHUNK_WORDS) {
+      index_t count = e - i;
+      if (count > STREAM_CHUNK_WORDS) {
+        count = STREAM_CHUNK_WORDS;
+      }
+      stream.Words(offset + i, words, count);
+      for (index_t j = 0; j < count; j++) {
+        swaps[i + j] = Bounded(words[j], i + j + 1);
+      }
+    }
+  });
+}
+
+// Words [0, n) of the stream pick the bucket of every element, words
+// [n, 2n) shuffle the buckets.
+void Permutation(int seed, index_t* out, index_t n, index_t bucket_size) {
+  if (n == 0) {
+    return;
+  }
+  Stream stream(seed);
+  uint64_t buckets = (n + bucket_size - 1) / bucket_size;
+  unsigned threads = parallel::ThreadCount();
+
+  // Count the elements of every (thread, bucket).
+  std::vector<index_t> offsets(threads * buckets, 0);
+  parallel::ParallelFor(n, [&](unsigned tid, index_t s, index_t e) {
+    index_t* counts = &offsets[tid * buckets];
+    ForEachBucket(stream, buckets, s, e,
+                  [=](index_t, index_t bucket) { counts[bucket]++; });
+  });
+
+  // Elements of a bucket are ordered by thread, then by index, so the
+  // result does not depend on how [0, n) is split among threads.
+  std::vector<index_t> starts(buckets + 1);
+  index_t sum = 0;
+  for (uint64_t bucket = 0; bucket < buckets; bucket++) {
+    starts[bucket] = sum;
+    for (unsigned tid = 0; tid < threads; tid++) {
+      index_t count = offsets[tid * buckets + bucket];
+      offsets[tid * buckets + bucket] = sum;
+      sum += count;
+    }
+  }
+  starts[buckets] = n;
+
+  // Scatter.
+  parallel::ParallelFor(n, [&](unsigned tid, index_t s, index_t e) {
+    index_t* next = &offsets[tid * buckets];
+    ForEachBucket(stream, buckets, s, e, [=](index_t i, index_t bucket) {
+      out[next[bucket]++] = i;
+    });
+  });
+
+  // Shuffle every bucket (Fisher-Yates).
+  parallel::ParallelFor(buckets, [&](unsigned, index_t s, index_t e) {
+    std::vector<uint64_t> words;
+    for (index_t bucket = s; bucket < e; bucket++) {
+      index_t start = starts[bucket];
+      index_t size = starts[bucket + 1] - start;
+      words.resize(size);
+      stream.Words(static_cast<uint64_t>(n) + start, words.data(), size);
+      index_t* arr = out + start;
+      for (index_t i = size; i > 1; i--) {
+        std::swap(arr[i - 1], arr[Bounded(words[i - 1], i)]);
+      }
+    }
+  });
 }
 
 }  // namespace util
@@ -1,24 +1,83 @@
 #ifndef DPPIR_SHUFFLE_UTIL_H_
 #define DPPIR_SHUFFLE_UTIL_H_
 
+#include <cstddef>
 #include <cstdint>
-#include <cstdlib>
+#include <memory>
 #include <utility>
 
+#include "DPPIR/types/types.h"
+// NOLINTNEXTLINE
+#include "sodium.h"
+
+// Words of the stream generated at once.
+#define STREAM_CHUNK_WORDS 512
+// Average bucket size of Permutation() (fits in L2 cache).
+#define PERMUTATION_BUCKET_SIZE (1 << 16)
+
 namespace DPPIR {
 namespace shuffle {
 namespace util {
 
-// Random sampling.
-void seed(int s);
-uint32_t random_bounded(uint32_t range);
+// Counter-based random stream: the ChaCha20 keystream under a key derived
+// from a seed. Any part of the stream can be computed on its own, so threads
+// can generate disjoint parts of the same stream.
+class Stream {
+ public:
+  explicit Stream(int seed);
+
+  // Writes the 64-bit words [start, start + count) of the stream to out.
+  void Words(uint64_t start, uint64_t* out, size_t count) const;
+
+ private:
+  unsigned char key_[crypto_stream_chacha20_KEYBYTES];
+};
+
+// Reads the words of a stream one after the other, from start.
+class StreamReader {
+ public:
+  StreamReader(const Stream& stream, uint64_t start);
+
+  uint64_t Next();
+  // Uniform in [0, 1).
+  double NextDouble();
 
-// Shuffle.
+ private:
+  const Stream& stream_;
+  uint64_t next_;
+  // The 64 byte block of the stream that next_ is in.
+  bool buffered_;
+  uint64_t buffer_[8];
+};
+
+// Number of good elements among sample elements drawn without replacement
+// from good + bad elements (hypergeometric distribution).
+uint64_t Hypergeometric(StreamReader* reader, uint64_t good, uint64_t bad,
+                        uint64_t sample);
+
+// Sets swaps[i] to a uniform element of [0, i] for every i in [0, n), from
+// word offset + i of the stream of seed. Computed in parallel, the result
+// does not depend on the number of threads.
+void SampleSwaps(int seed, index_t* swaps, index_t n, uint64_t offset = 0);
+
+// Writes a uniformly random permutation of [0, n) to out, in parallel.
+// Elements are scattered to random buckets of about bucket_size elements
+// (stable within a bucket), then every bucket is shuffled on its own.
+// The same seed gives the same permutation for any number of threads.
+void Permutation(int seed, index_t* out, index_t n,
+                 index_t bucket_size = PERMUTATION_BUCKET_SIZE);
+
+// Shuffle (Fisher-Yates). The same seed (and offset) gives the same
+// permutation.
 template <typename T>
-void shuffle(T arr[], size_t n) {
-  for (size_t i = n; i > 1; i--) {
-    size_t p = random_bounded(i);  // number in [0,i)
-    std::swap(arr[i - 1], arr[p]);
+void shuffle(T arr[], index_t n, int seed, uint64_t offset = 0) {
+  if (n < 2) {
+    return;
+  }
+  std::unique_ptr<index_t[]> swaps = std::make_unique<index_t[]>(n);
+  SampleSwaps(seed, swaps.get(), n, offset);
+  for (index_t i = n - 1; i > 0; i--) {
+    std::swap(arr[i], arr[swaps[i]]);
   }
 }
 
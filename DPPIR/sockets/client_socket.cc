@@ -13,16 +13,18 @@ void ClientSocket::Initialize(const std::string& ip, int port) {
   std::cout << "Connecting to server..." << std::endl;
   std::cout << "Server at " << ip << ":" << port << std::endl;
   this->sockfd_ = common::ConnectTo(ip.c_str(), port);
+  this->transport_->Add(this->sockfd_);
   std::cout << "Connected to the server!" << std::endl;
 }
 
 // Logistics.
 void ClientSocket::SendCount(index_t count) {
-  common::Send(this->sockfd_, reinterpret_cast<char*>(&count), sizeof(count));
+  this->transport_->Send(this->sockfd_, reinterpret_cast<char*>(&count),
+                         sizeof(count));
 }
 void ClientSocket::WaitForReady() {
   char ready = 0;
-  common::Read(this->sockfd_, &ready, sizeof(char));
+  this->transport_->Read(this->sockfd_, &ready, sizeof(char));
   assert(ready == 1);
 }
 
@@ -30,29 +32,46 @@ void ClientSocket::WaitForReady() {
 void ClientSocket::SendCipher(const char* onion_cipher) {
   this->cipher_wbuf_.PushBack(onion_cipher);
   if (this->cipher_wbuf_.Full()) {
-    this->FlushCiphers();
+    this->transport_->Send(this->sockfd_, &this->cipher_wbuf_);
+    this->cipher_wbuf_.Clear();
   }
 }
 void ClientSocket::SendQuery(const Query& query) {
   this->query_wbuf_.PushBack(query);
   if (this->query_wbuf_.Full()) {
-    this->FlushQueries();
+    this->transport_->Send(this->sockfd_, &this->query_wbuf_);
+    this->query_wbuf_.Clear();
   }
 }
 
-// Buffer flush.
+// Buffer flush: returns when everything is sent.
 void ClientSocket::FlushCiphers() {
-  common::Send(this->sockfd_, &this->cipher_wbuf_);
+  this->transport_->Send(this->sockfd_, &this->cipher_wbuf_);
   this->cipher_wbuf_.Clear();
+  this->transport_->Flush(this->sockfd_);
 }
 void ClientSocket::FlushQueries() {
-  common::Send(this->sockfd_, &this->query_wbuf_);
+  this->transport_->Send(this->sockfd_, &this->query_wbuf_);
   this->query_wbuf_.Clear();
+  this->transport_->Flush(this->sockfd_);
+}
+
+// Unbuffered send.
+void ClientSocket::SendCiphers(const iovec* ciphers, size_t count) {
+  this->transport_->Send(this->sockfd_, &this->cipher_wbuf_);
+  this->cipher_wbuf_.Clear();
+  this->transport_->SendDirect(this->sockfd_, ciphers, count);
+}
+void ClientSocket::SendQueries(const Query* queries, index_t count) {
+  this->transport_->Send(this->sockfd_, &this->query_wbuf_);
+  this->query_wbuf_.Clear();
+  iovec region = {const_cast<Query*>(queries), count * sizeof(Query)};
+  this->transport_->SendDirect(this->sockfd_, &region, 1);
 }
 
 // Read responses.
 LogicalBuffer<Response>& ClientSocket::ReadResponses(index_t read_count) {
-  common::Read(this->sockfd_, read_count, &this->response_rbuf_);
+  this->transport_->Read(this->sockfd_, read_count, &this->response_rbuf_);
   return this->response_rbuf_;
 }
 
@@ -1,9 +1,12 @@
 #ifndef DPPIR_SOCKETS_CLIENT_SOCKET_H_
 #define DPPIR_SOCKETS_CLIENT_SOCKET_H_
 
+#include <sys/uio.h>
+
 #include <string>
 
 #include "DPPIR/sockets/consts.h"
+#include "DPPIR/sockets/transport.h"
 #include "DPPIR/types/containers.h"
 #include "DPPIR/types/types.h"
 
@@ -12,8 +15,9 @@ namespace sockets {
 
 class ClientSocket {
  public:
-  explicit ClientSocket(size_t outgoing_cipher_size)
-      : sockfd_(-1),
+  ClientSocket(size_t outgoing_cipher_size, Transport* transport)
+      : transport_(transport),
+        sockfd_(-1),
         rbuffer_(),
         wbuffer_(),
         cipher_wbuf_(&wbuffer_, outgoing_cipher_size),
@@ -32,15 +36,21 @@ class ClientSocket {
   // Writing offline messages.
   void SendCipher(const char* onion_cipher);
   void FlushCiphers();
+  // Send count ciphers from their memory (see Transport::SendDirect()), after
+  // the buffered ones.
+  void SendCiphers(const iovec* ciphers, size_t count);
 
   // Only writes queries.
   void SendQuery(const Query& query);
   void FlushQueries();
+  // Send count contiguous queries from their memory, after the buffered ones.
+  void SendQueries(const Query* queries, index_t count);
 
   // Only reads responses.
   LogicalBuffer<Response>& ReadResponses(index_t read_count);
 
  private:
+  Transport* transport_;
   int sockfd_;
   // Physical buffers for reading and writing.
   PhysicalBuffer<BUFFER_SIZE> rbuffer_;
@@ -124,12 +124,6 @@ void Read(int fd, char* buf, size_t buf_size) {
   }
 }
 
-size_t ReadSome(int fd, char* buf, size_t buf_size) {
-  auto status = read(fd, buf, buf_size);
-  MY_ASSERT(status);
-  return status;
-}
-
 void Send(int fd, char* buf, size_t size) {
   size_t sent = 0;
   while (sent < size) {
@@ -139,23 +133,6 @@ void Send(int fd, char* buf, size_t size) {
   }
 }
 
-// Poll many fds, either blocking or non-blocking.
-size_t Poll(pollfd* pollfds, size_t count, int timeout, bool* result) {
-  int nfds = poll(pollfds, count, timeout);
-  MY_ASSERT(nfds);
-  assert(nfds <= static_cast<int>(count));
-  size_t res = nfds;
-  for (size_t id = 0; nfds > 0; id++) {
-    auto& revents = pollfds[id].revents;
-    if (revents & POLLIN) {
-      revents = 0;
-      result[id] = true;
-      nfds--;
-    }
-  }
-  return res;
-}
-
 }  // namespace common
 }  // namespace sockets
 }  // namespace DPPIR
@@ -6,6 +6,17 @@
 #define POLL_RATE 140000
 #define PROGRESS_RATE 750000
 
+// Transport: bytes queued (resp. read ahead) per chunk, and bytes queued per
+// socket before sending waits.
+#define TRANSPORT_CHUNK BUFFER_SIZE
+#define MAX_QUEUED (64 * BUFFER_SIZE)
+// Events handled per epoll_wait().
+#define TRANSPORT_EVENTS 64
+// Regions sent with one sendmsg(), and the smallest (average) region size
+// that MSG_ZEROCOPY is used for (it pins whole pages).
+#define GATHER_COUNT 1024
+#define ZEROCOPY_MIN_REGION 4096
+
 // TCP socket configs.
 // 10 MB
 #define RCVBUF 12328960
@@ -11,8 +11,9 @@ namespace sockets {
 
 // Constructor.
 ParallelSocket::ParallelSocket(server_id_t server_id, server_id_t server_count,
-                               size_t cipher_size)
-    : server_id_(server_id),
+                               size_t cipher_size, Transport* transport)
+    : transport_(transport),
+      server_id_(server_id),
       server_count_(server_count),
       // Initializes each element using default constructor.
       sockfds_(server_id, server_count),
@@ -67,6 +68,7 @@ void ParallelSocket::Initialize(const config::PartyConfig& config) {
       common::Read(fd, reinterpret_cast<char*>(&server_id), sizeof(server_id));
       assert(server_id < this->server_id_);
       // Fill in relevant pollfd struct.
+      this->transport_->Add(fd);
       this->sockfds_[server_id] = fd;
       pollfd& v = this->pollfds_[server_id];
       v.fd = fd;
@@ -86,15 +88,16 @@ void ParallelSocket::Initialize(const config::PartyConfig& config) {
     std::cout << "Server at  " << conf.ip << ":" << conf.parallel_port
               << std::endl;
     int fd = common::ConnectTo(conf.ip.c_str(), conf.parallel_port);
+    // Declare identity to server.
+    common::Send(fd, reinterpret_cast<char*>(&this->server_id_),
+                 sizeof(this->server_id_));
     // Fill in pollfd struct.
+    this->transport_->Add(fd);
     this->sockfds_[id] = fd;
     pollfd& v = this->pollfds_[id];
     v.fd = fd;
     v.events = POLLIN;
     v.revents = 0;
-    // Declare identity to server.
-    common::Send(fd, reinterpret_cast<char*>(&this->server_id_),
-                 sizeof(this->server_id_));
     std::cout << "Connected to parallel server " << int(id) << std::endl;
   }
 }
@@ -102,7 +105,8 @@ void ParallelSocket::Initialize(const config::PartyConfig& config) {
 // Logistics.
 void ParallelSocket::SendCount(server_id_t target, index_t count) {
   int sockfd = this->sockfds_[target];
-  common::Send(sockfd, reinterpret_cast<char*>(&count), sizeof(count));
+  this->transport_->Send(sockfd, reinterpret_cast<char*>(&count),
+                         sizeof(count));
 }
 void ParallelSocket::BroadcastCount(index_t count) {
   for (server_id_t id = 0; id < this->server_count_; id++) {
@@ -113,8 +117,8 @@ void ParallelSocket::BroadcastCount(index_t count) {
 }
 index_t ParallelSocket::ReadCount(server_id_t id) {
   index_t count;
-  common::Read(this->sockfds_[id], reinterpret_cast<char*>(&count),
-               sizeof(count));
+  this->transport_->Read(this->sockfds_[id], reinterpret_cast<char*>(&count),
+                         sizeof(count));
   return count;
 }
 void ParallelSocket::BroadcastReady() {
@@ -122,7 +126,7 @@ void ParallelSocket::BroadcastReady() {
   for (server_id_t id = 0; id < this->server_count_; id++) {
     if (id != this->server_id_) {
       int sockfd = this->sockfds_[id];
-      common::Send(sockfd, &ready, sizeof(ready));
+      this->transport_->Send(sockfd, &ready, sizeof(ready));
     }
   }
 }
@@ -131,7 +135,7 @@ void ParallelSocket::WaitForReady() {
     if (id != this->server_id_) {
       char ready = 0;
       int sockfd = this->sockfds_[id];
-      common::Read(sockfd, &ready, sizeof(ready));
+      this->transport_->Read(sockfd, &ready, sizeof(ready));
       assert(ready == 1);
     }
   }
@@ -139,8 +143,8 @@ void ParallelSocket::WaitForReady() {
 
 // Poll API.
 server_id_t ParallelSocket::Poll(ServersMap<bool>* outs, int timeout) {
-  return common::Poll(this->pollfds_.Ptr(), this->server_count_ - 1, timeout,
-                      outs->Ptr());
+  return this->transport_->Poll(this->pollfds_.Ptr(), this->server_count_ - 1,
+                               timeout, outs->Ptr());
 }
 void ParallelSocket::IgnoreServer(server_id_t id) {
   this->pollfds_[id].fd = this->sockfds_[id] * -1;
@@ -157,7 +161,7 @@ void ParallelSocket::ResetServers() {
 CipherLogicalBuffer& ParallelSocket::ReadCiphers(server_id_t source,
                                                  index_t read_count) {
   int fd = this->sockfds_[source];
-  common::Read(fd, read_count, &this->cipher_rbufs_[source]);
+  this->transport_->Read(fd, read_count, &this->cipher_rbufs_[source]);
   return this->cipher_rbufs_[source];
 }
 
@@ -165,21 +169,21 @@ CipherLogicalBuffer& ParallelSocket::ReadCiphers(server_id_t source,
 LogicalBuffer<OfflineSecret>& ParallelSocket::ReadSecrets(server_id_t source,
                                                           index_t read_count) {
   int fd = this->sockfds_[source];
-  common::Read(fd, read_count, &this->secret_rbufs_[source]);
+  this->transport_->Read(fd, read_count, &this->secret_rbufs_[source]);
   return this->secret_rbufs_[source];
 }
 
 LogicalBuffer<Query>& ParallelSocket::ReadQueries(server_id_t source,
                                                   index_t read_count) {
   int fd = this->sockfds_[source];
-  common::Read(fd, read_count, &this->query_rbufs_[source]);
+  this->transport_->Read(fd, read_count, &this->query_rbufs_[source]);
   return this->query_rbufs_[source];
 }
 
 LogicalBuffer<Response>& ParallelSocket::ReadResponses(server_id_t source,
                                                        index_t read_count) {
   int fd = this->sockfds_[source];
-  common::Read(fd, read_count, &this->response_rbufs_[source]);
+  this->transport_->Read(fd, read_count, &this->response_rbufs_[source]);
   return this->response_rbufs_[source];
 }
 
@@ -188,21 +192,21 @@ void ParallelSocket::SendCipher(server_id_t target, const char* onion_cipher) {
   CipherLogicalBuffer& buffer = this->cipher_wbufs_[target];
   buffer.PushBack(onion_cipher);
   if (buffer.Full()) {
-    this->FlushCiphers(target);
+    this->SendBuffer(target, &buffer);
   }
 }
 void ParallelSocket::SendQuery(server_id_t target, const Query& query) {
   LogicalBuffer<Query>& buffer = this->query_wbufs_[target];
   buffer.PushBack(query);
   if (buffer.Full()) {
-    this->FlushQueries(target);
+    this->SendBuffer(target, &buffer);
   }
 }
 void ParallelSocket::SendResponse(server_id_t target, const Response& r) {
   LogicalBuffer<Response>& buffer = this->response_wbufs_[target];
   buffer.PushBack(r);
   if (buffer.Full()) {
-    this->FlushResponses(target);
+    this->SendBuffer(target, &buffer);
   }
 }
 void ParallelSocket::BroadcastSecret(const OfflineSecret& secret) {
@@ -211,7 +215,7 @@ void ParallelSocket::BroadcastSecret(const OfflineSecret& secret) {
       LogicalBuffer<OfflineSecret>& buffer = this->secret_wbufs_[target];
       buffer.PushBack(secret);
       if (buffer.Full()) {
-        this->FlushSecrets(target);
+        this->SendBuffer(target, &buffer);
       }
     }
   }
@@ -221,48 +225,60 @@ void ParallelSocket::BroadcastSecret(const OfflineSecret& secret) {
 void ParallelSocket::FlushCiphers() {
   for (server_id_t id = 0; id < this->server_count_; id++) {
     if (id != this->server_id_) {
-      this->FlushCiphers(id);
+      this->SendBuffer(id, &this->cipher_wbufs_[id]);
     }
   }
+  this->Flush();
 }
 void ParallelSocket::FlushSecrets() {
   for (server_id_t id = 0; id < this->server_count_; id++) {
     if (id != this->server_id_) {
-      this->FlushSecrets(id);
+      this->SendBuffer(id, &this->secret_wbufs_[id]);
     }
   }
+  this->Flush();
 }
 void ParallelSocket::FlushQueries() {
   for (server_id_t id = 0; id < this->server_count_; id++) {
     if (id != this->server_id_) {
-      this->FlushQueries(id);
+      this->SendBuffer(id, &this->query_wbufs_[id]);
     }
   }
+  this->Flush();
 }
 void ParallelSocket::FlushResponses() {
   for (server_id_t id = 0; id < this->server_count_; id++) {
     if (id != this->server_id_) {
-      this->FlushResponses(id);
+      this->SendBuffer(id, &this->response_wbufs_[id]);
     }
   }
+  this->Flush();
 }
 
 // Flush buffer of a specific target server.
 void ParallelSocket::FlushCiphers(server_id_t id) {
-  common::Send(this->sockfds_[id], &this->cipher_wbufs_[id]);
-  this->cipher_wbufs_[id].Clear();
+  this->SendBuffer(id, &this->cipher_wbufs_[id]);
+  this->transport_->Flush(this->sockfds_[id]);
 }
 void ParallelSocket::FlushSecrets(server_id_t id) {
-  common::Send(this->sockfds_[id], &this->secret_wbufs_[id]);
-  this->secret_wbufs_[id].Clear();
+  this->SendBuffer(id, &this->secret_wbufs_[id]);
+  this->transport_->Flush(this->sockfds_[id]);
 }
 void ParallelSocket::FlushQueries(server_id_t id) {
-  common::Send(this->sockfds_[id], &this->query_wbufs_[id]);
-  this->query_wbufs_[id].Clear();
+  this->SendBuffer(id, &this->query_wbufs_[id]);
+  this->transport_->Flush(this->sockfds_[id]);
 }
 void ParallelSocket::FlushResponses(server_id_t id) {
-  common::Send(this->sockfds_[id], &this->response_wbufs_[id]);
-  this->response_wbufs_[id].Clear();
+  this->SendBuffer(id, &this->response_wbufs_[id]);
+  this->transport_->Flush(this->sockfds_[id]);
+}
+
+void ParallelSocket::Flush() {
+  for (server_id_t id = 0; id < this->server_count_; id++) {
+    if (id != this->server_id_) {
+      this->transport_->Flush(this->sockfds_[id]);
+    }
+  }
 }
 
 }  // namespace sockets
@@ -5,6 +5,7 @@
 
 #include "DPPIR/config/config.h"
 #include "DPPIR/sockets/consts.h"
+#include "DPPIR/sockets/transport.h"
 #include "DPPIR/types/containers.h"
 #include "DPPIR/types/types.h"
 
@@ -15,7 +16,7 @@ namespace sockets {
 class ParallelSocket {
  public:
   ParallelSocket(server_id_t server_id, server_id_t server_count,
-                 size_t cipher_size);
+                 size_t cipher_size, Transport* transport);
 
   // Connect to all other servers.
   void Initialize(const config::PartyConfig& config);
@@ -46,7 +47,8 @@ class ParallelSocket {
   void SendResponse(server_id_t target, const Response& response);
   void BroadcastSecret(const OfflineSecret& secret);  // to all servers.
 
-  // Flush API: either for a specific parallel server or for all.
+  // Flush API: either for a specific parallel server or for all, returns when
+  // everything is sent.
   void FlushCiphers();
   void FlushSecrets();
   void FlushQueries();
@@ -57,6 +59,16 @@ class ParallelSocket {
   void FlushResponses(server_id_t id);
 
  private:
+  // Hand the buffer of a sibling to the transport (without waiting).
+  template <typename LOGICAL_BUFFER>
+  void SendBuffer(server_id_t id, LOGICAL_BUFFER* buffer) {
+    this->transport_->Send(this->sockfds_[id], buffer);
+    buffer->Clear();
+  }
+  // Wait until everything is sent to all siblings.
+  void Flush();
+
+  Transport* transport_;
   // Count of parallel servers.
   server_id_t server_id_;
   server_id_t server_count_;
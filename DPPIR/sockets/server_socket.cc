@@ -12,27 +12,29 @@ void ServerSocket::Initialize(int port) {
   std::cout << "Creating server and accepting connections..." << std::endl;
   std::cout << "On port " << port << std::endl;
   common::ListenOn(port, &this->sockfd_, 1);
+  this->transport_->Add(this->sockfd_);
   std::cout << "Client connected!" << std::endl;
 }
 
 // Logistics.
 index_t ServerSocket::ReadCount() {
   index_t count = 0;
-  common::Read(this->sockfd_, reinterpret_cast<char*>(&count), sizeof(count));
+  this->transport_->Read(this->sockfd_, reinterpret_cast<char*>(&count),
+                         sizeof(count));
   return count;
 }
 void ServerSocket::SendReady() {
   char ready = 1;
-  common::Send(this->sockfd_, &ready, sizeof(ready));
+  this->transport_->Send(this->sockfd_, &ready, sizeof(ready));
 }
 
 // Buffered reads.
 CipherLogicalBuffer& ServerSocket::ReadCiphers(index_t read_count) {
-  common::Read(this->sockfd_, read_count, &this->cipher_rbuf_);
+  this->transport_->Read(this->sockfd_, read_count, &this->cipher_rbuf_);
   return this->cipher_rbuf_;
 }
 LogicalBuffer<Query>& ServerSocket::ReadQueries(index_t read_count) {
-  common::Read(this->sockfd_, read_count, &this->query_rbuf_);
+  this->transport_->Read(this->sockfd_, read_count, &this->query_rbuf_);
   return this->query_rbuf_;
 }
 
@@ -40,14 +42,24 @@ LogicalBuffer<Query>& ServerSocket::ReadQueries(index_t read_count) {
 void ServerSocket::SendResponse(const Response& response) {
   this->response_wbuf_.PushBack(response);
   if (this->response_wbuf_.Full()) {
-    this->FlushResponses();
+    this->transport_->Send(this->sockfd_, &this->response_wbuf_);
+    this->response_wbuf_.Clear();
   }
 }
 
-// Buffer flush.
+// Unbuffered send.
+void ServerSocket::SendResponses(const Response* responses, index_t count) {
+  this->transport_->Send(this->sockfd_, &this->response_wbuf_);
+  this->response_wbuf_.Clear();
+  iovec region = {const_cast<Response*>(responses), count * sizeof(Response)};
+  this->transport_->SendDirect(this->sockfd_, &region, 1);
+}
+
+// Buffer flush: returns when everything is sent.
 void ServerSocket::FlushResponses() {
-  common::Send(this->sockfd_, &this->response_wbuf_);
+  this->transport_->Send(this->sockfd_, &this->response_wbuf_);
   this->response_wbuf_.Clear();
+  this->transport_->Flush(this->sockfd_);
 }
 
 }  // namespace sockets
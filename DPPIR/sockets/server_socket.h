@@ -1,7 +1,10 @@
 #ifndef DPPIR_SOCKETS_SERVER_SOCKET_H_
 #define DPPIR_SOCKETS_SERVER_SOCKET_H_
 
+#include <sys/uio.h>
+
 #include "DPPIR/sockets/consts.h"
+#include "DPPIR/sockets/transport.h"
 #include "DPPIR/types/containers.h"
 #include "DPPIR/types/types.h"
 
@@ -10,8 +13,9 @@ namespace sockets {
 
 class ServerSocket {
  public:
-  explicit ServerSocket(size_t incoming_cipher_size)
-      : sockfd_(-1),
+  ServerSocket(size_t incoming_cipher_size, Transport* transport)
+      : transport_(transport),
+        sockfd_(-1),
         rbuffer_(),
         wbuffer_(),
         cipher_rbuf_(&rbuffer_, incoming_cipher_size),
@@ -36,8 +40,12 @@ class ServerSocket {
   // Only writes responses.
   void SendResponse(const Response& response);
   void FlushResponses();
+  // Send count contiguous responses from their memory (see
+  // Transport::SendDirect()), after the buffered ones.
+  void SendResponses(const Response* responses, index_t count);
 
  private:
+  Transport* transport_;
   int sockfd_;
   // Physical buffers for reading and writing.
   PhysicalBuffer<BUFFER_SIZE> rbuffer_;
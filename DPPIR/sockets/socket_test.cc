@@ -1,11 +1,13 @@
 // NOLINTNEXTLINE
 #include <chrono>
+#include <cstring>
 #include <iostream>
 // NOLINTNEXTLINE
 #include <thread>
 
 #include "DPPIR/sockets/client_socket.h"
 #include "DPPIR/sockets/server_socket.h"
+#include "DPPIR/sockets/transport.h"
 
 #define OFFLINE_MSG_SIZE 96
 #define OFFLINE_COUNT 1023688
@@ -73,7 +75,8 @@ bool IsCorrect() {
 }
 
 void Client() {
-  ClientSocket client_socket(OFFLINE_MSG_SIZE);
+  Transport transport;
+  ClientSocket client_socket(OFFLINE_MSG_SIZE, &transport);
   client_socket.Initialize("127.0.0.1", 3000);
   std::cout << "(Client) Client connected!" << std::endl;
 
@@ -108,14 +111,53 @@ void Client() {
     for (Response& r : buffer) {
       rresponses[read++] = r;
     }
+    buffer.Clear();
   }
   e = std::chrono::steady_clock::now();
   d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
   std::cout << "(Client) Reading responses done in " << d << "ms" << std::endl;
+
+  // Send queries again while the server sends responses again, neither reads
+  // until done sending (which only works if sending does not stall reading).
+  memset(rresponses, 0, sizeof(rresponses));
+  s = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < QUERY_COUNT; i++) {
+    client_socket.SendQuery(queries[i]);
+  }
+  client_socket.FlushQueries();
+  read = 0;
+  while (read != RESPONSE_COUNT) {
+    auto& buffer = client_socket.ReadResponses(RESPONSE_COUNT - read);
+    for (Response& r : buffer) {
+      rresponses[read++] = r;
+    }
+    buffer.Clear();
+  }
+  e = std::chrono::steady_clock::now();
+  d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
+  std::cout << "(Client) Exchange done in " << d << "ms" << std::endl;
+
+  // Same, sending directly from memory with zero copy.
+  memset(rresponses, 0, sizeof(rresponses));
+  transport.SetZeroCopy(true);
+  s = std::chrono::steady_clock::now();
+  client_socket.SendQueries(queries, QUERY_COUNT);
+  read = 0;
+  while (read != RESPONSE_COUNT) {
+    auto& buffer = client_socket.ReadResponses(RESPONSE_COUNT - read);
+    for (Response& r : buffer) {
+      rresponses[read++] = r;
+    }
+    buffer.Clear();
+  }
+  e = std::chrono::steady_clock::now();
+  d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
+  std::cout << "(Client) Direct exchange done in " << d << "ms" << std::endl;
 }
 
 void Server() {
-  ServerSocket server_socket(OFFLINE_MSG_SIZE);
+  Transport transport;
+  ServerSocket server_socket(OFFLINE_MSG_SIZE, &transport);
   server_socket.Initialize(3000);
   std::cout << "(Server) Server connected!" << std::endl;
 
@@ -127,6 +169,7 @@ void Server() {
     for (char* cipher : buffer) {
       memcpy(roffline + (read++ * OFFLINE_MSG_SIZE), cipher, OFFLINE_MSG_SIZE);
     }
+    buffer.Clear();
   }
   auto e = std::chrono::steady_clock::now();
   auto d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
@@ -143,6 +186,7 @@ void Server() {
     for (size_t i = 0; i < buffer.Size(); i++) {
       rqueries[read++] = buffer[i];
     }
+    buffer.Clear();
   }
   e = std::chrono::steady_clock::now();
   d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
@@ -157,6 +201,42 @@ void Server() {
   e = std::chrono::steady_clock::now();
   d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
   std::cout << "(Server) Sending responses done in " << d << "ms" << std::endl;
+
+  // Send responses again while the client sends queries again.
+  memset(rqueries, 0, sizeof(rqueries));
+  s = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < RESPONSE_COUNT; i++) {
+    server_socket.SendResponse(responses[i]);
+  }
+  server_socket.FlushResponses();
+  read = 0;
+  while (read != QUERY_COUNT) {
+    auto& buffer = server_socket.ReadQueries(QUERY_COUNT - read);
+    for (size_t i = 0; i < buffer.Size(); i++) {
+      rqueries[read++] = buffer[i];
+    }
+    buffer.Clear();
+  }
+  e = std::chrono::steady_clock::now();
+  d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
+  std::cout << "(Server) Exchange done in " << d << "ms" << std::endl;
+
+  // Same, sending directly from memory with zero copy.
+  memset(rqueries, 0, sizeof(rqueries));
+  transport.SetZeroCopy(true);
+  s = std::chrono::steady_clock::now();
+  server_socket.SendResponses(responses, RESPONSE_COUNT);
+  read = 0;
+  while (read != QUERY_COUNT) {
+    auto& buffer = server_socket.ReadQueries(QUERY_COUNT - read);
+    for (size_t i = 0; i < buffer.Size(); i++) {
+      rqueries[read++] = buffer[i];
+    }
+    buffer.Clear();
+  }
+  e = std::chrono::steady_clock::now();
+  d = std::chrono::duration_cast<std::chrono::milliseconds>(e - s).count();
+  std::cout << "(Server) Direct exchange done in " << d << "ms" << std::endl;
 }
 
 }  // namespace sockets
@@ -0,0 +1,462 @@
+#include "DPPIR/sockets/transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace DPPIR {
+namespace sockets {
+
+namespace {
+
+// Whether a non-blocking socket call should be retried once the socket is
+// ready, fails on any other error.
+bool WouldBlock(ssize_t status) {
+  if (status >= 0) {
+    return false;
+  }
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+    return true;
+  }
+  perror("socket error: ");
+  assert(false);
+  return false;
+}
+
+// Fails if fd has a pending error.
+void CheckError(int fd) {
+  int error = 0;
+  socklen_t size = sizeof(error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size) < 0 || error != 0) {
+    errno = error;
+    perror("socket error: ");
+    assert(false);
+  }
+}
+
+}  // namespace
+
+Transport::Transport()
+    : epfd_(epoll_create1(EPOLL_CLOEXEC)),
+      zerocopy_(false),
+      channels_(),
+      spare_() {
+  if (this->epfd_ < 0) {
+    perror("epoll error: ");
+    assert(false);
+  }
+}
+
+Transport::~Transport() {
+  this->Flush();
+  close(this->epfd_);
+}
+
+void Transport::Add(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  assert(flags >= 0);
+  flags = fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  assert(flags >= 0);
+  Channel& channel = this->channels_[fd];
+  channel.queued = 0;
+  channel.writing = false;
+  channel.watched = false;
+  channel.readable = false;
+  channel.closed = false;
+  channel.zerocopy = 0;
+  channel.zerocopy_sent = 0;
+  channel.zerocopy_done = 0;
+  this->Update(fd, channel);
+}
+
+// Sending.
+void Transport::Send(int fd, const char* buf, size_t size) {
+  Channel& channel = this->channels_.at(fd);
+  // Nothing queued before: send as much as the socket takes right away.
+  if (channel.queued == 0) {
+    ssize_t status = send(fd, buf, size, MSG_NOSIGNAL);
+    if (!WouldBlock(status)) {
+      buf += status;
+      size -= status;
+    }
+  }
+  // Queue the rest.
+  while (size > 0) {
+    if (channel.out.empty() || channel.out.back().end == TRANSPORT_CHUNK) {
+      channel.out.push_back(this->NewChunk());
+    }
+    Chunk& chunk = channel.out.back();
+    size_t count = TRANSPORT_CHUNK - chunk.end;
+    if (count > size) {
+      count = size;
+    }
+    memcpy(chunk.data.get() + chunk.end, buf, count);
+    chunk.end += count;
+    channel.queued += count;
+    buf += count;
+    size -= count;
+  }
+  if (channel.queued > 0 && !channel.writing) {
+    channel.writing = true;
+    this->Update(fd, channel);
+  }
+  // Too much is queued: wait for the peer to catch up.
+  while (channel.queued > MAX_QUEUED) {
+    this->Wait(-1);
+  }
+}
+
+void Transport::Flush(int fd) {
+  Channel& channel = this->channels_.at(fd);
+  while (channel.queued > 0) {
+    this->Wait(-1);
+  }
+}
+
+void Transport::Flush() {
+  for (auto& [fd, channel] : this->channels_) {
+    while (channel.queued > 0) {
+      this->Wait(-1);
+    }
+  }
+}
+
+void Transport::SendDirect(int fd, const iovec* iov, size_t count) {
+  Channel& channel = this->channels_.at(fd);
+  this->Flush(fd);
+  std::vector<iovec> regions(iov, iov + count);
+  size_t i = 0;
+  while (true) {
+    while (i < regions.size() && regions[i].iov_len == 0) {
+      i++;
+    }
+    if (i == regions.size()) {
+      break;
+    }
+    msghdr msg = {};
+    msg.msg_iov = regions.data() + i;
+    msg.msg_iovlen = regions.size() - i;
+    if (msg.msg_iovlen > GATHER_COUNT) {
+      msg.msg_iovlen = GATHER_COUNT;
+    }
+    size_t bytes = 0;
+    for (size_t j = 0; j < msg.msg_iovlen; j++) {
+      bytes += msg.msg_iov[j].iov_len;
+    }
+    bool zerocopy = this->zerocopy_ &&
+                    bytes >= ZEROCOPY_MIN_REGION * msg.msg_iovlen &&
+                    this->EnableZeroCopy(fd, &channel);
+    int flags = MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0);
+    ssize_t status = sendmsg(fd, &msg, flags);
+    if (status < 0 && errno == ENOBUFS && zerocopy) {
+      // Too much memory is pinned: wait for the kernel to release some, or
+      // copy if it has nothing to release.
+      if (channel.zerocopy_done == channel.zerocopy_sent) {
+        channel.zerocopy = -1;
+      }
+      this->WaitZeroCopy(&channel);
+      continue;
+    }
+    if (WouldBlock(status)) {
+      // Handle other sockets until fd is writable (nothing is queued, so
+      // Write() just clears writing).
+      channel.writing = true;
+      this->Update(fd, channel);
+      while (channel.writing) {
+        this->Wait(-1);
+      }
+      continue;
+    }
+    if (zerocopy) {
+      channel.zerocopy_sent++;
+    }
+    // Skip what was sent.
+    size_t sent = status;
+    while (sent > 0) {
+      iovec& region = regions[i];
+      if (sent >= region.iov_len) {
+        sent -= region.iov_len;
+        i++;
+      } else {
+        region.iov_base = static_cast<char*>(region.iov_base) + sent;
+        region.iov_len -= sent;
+        sent = 0;
+      }
+    }
+  }
+  // The kernel may still read the memory of zero copy sends.
+  this->WaitZeroCopy(&channel);
+}
+
+// Reading.
+void Transport::Read(int fd, char* buf, size_t buf_size) {
+  size_t bytes = 0;
+  while (bytes < buf_size) {
+    size_t count = this->ReadSome(fd, buf + bytes, buf_size - bytes);
+    if (count == 0) {
+      fprintf(stderr, "socket error: connection closed\n");
+      assert(false);
+    }
+    bytes += count;
+  }
+}
+
+size_t Transport::ReadSome(int fd, char* buf, size_t buf_size) {
+  Channel& channel = this->channels_.at(fd);
+  while (true) {
+    // Whatever was read ahead comes first.
+    if (!channel.in.empty()) {
+      size_t bytes = 0;
+      while (bytes < buf_size && !channel.in.empty()) {
+        Chunk& chunk = channel.in.front();
+        size_t count = chunk.end - chunk.start;
+        if (count > buf_size - bytes) {
+          count = buf_size - bytes;
+        }
+        memcpy(buf + bytes, chunk.data.get() + chunk.start, count);
+        chunk.start += count;
+        bytes += count;
+        if (chunk.start == chunk.end) {
+          this->FreeChunk(&chunk);
+          channel.in.pop_front();
+        }
+      }
+      return bytes;
+    }
+    if (channel.closed) {
+      return 0;
+    }
+    ssize_t status = read(fd, buf, buf_size);
+    if (!WouldBlock(status)) {
+      if (status == 0) {
+        channel.closed = true;
+        this->Update(fd, channel);
+      } else if (static_cast<size_t>(status) < buf_size) {
+        channel.readable = false;  // Socket is drained.
+      }
+      return status;
+    }
+    // Nothing to read: handle other sockets until fd is readable.
+    channel.readable = false;
+    channel.watched = true;
+    while (!channel.readable) {
+      this->Wait(-1);
+    }
+    channel.watched = false;
+  }
+}
+
+size_t Transport::Poll(pollfd* pollfds, size_t count, int timeout,
+                       bool* result) {
+  // Level-triggered epoll reports every socket that has data right now.
+  for (size_t i = 0; i < count; i++) {
+    if (pollfds[i].fd >= 0) {
+      Channel& channel = this->channels_.at(pollfds[i].fd);
+      channel.watched = true;
+      channel.readable = false;
+    }
+  }
+  this->Wait(0);
+  size_t found = 0;
+  while (true) {
+    for (size_t i = 0; i < count; i++) {
+      if (pollfds[i].fd >= 0) {
+        // Like poll(), a closed socket is readable (reads return 0).
+        const Channel& channel = this->channels_.at(pollfds[i].fd);
+        if (!channel.in.empty() || channel.readable || channel.closed) {
+          result[i] = true;
+          found++;
+        }
+      }
+    }
+    if (found > 0 || timeout == 0) {
+      break;
+    }
+    this->Wait(timeout);
+    if (timeout > 0) {
+      timeout = 0;
+    }
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (pollfds[i].fd >= 0) {
+      this->channels_.at(pollfds[i].fd).watched = false;
+    }
+  }
+  return found;
+}
+
+// Event loop.
+bool Transport::Wait(int timeout) {
+  epoll_event events[TRANSPORT_EVENTS];
+  int n = epoll_wait(this->epfd_, events, TRANSPORT_EVENTS, timeout);
+  if (WouldBlock(n)) {
+    return false;
+  }
+  bool found = false;
+  for (int i = 0; i < n; i++) {
+    int fd = events[i].data.fd;
+    uint32_t flags = events[i].events;
+    Channel& channel = this->channels_.at(fd);
+    // Completions of zero copy sends come as errors, anything else on the
+    // error queue is a real error.
+    if ((flags & EPOLLERR) && channel.zerocopy > 0) {
+      if (this->Reap(fd, &channel)) {
+        flags &= ~EPOLLERR;
+      } else {
+        CheckError(fd);
+      }
+    }
+    if ((flags & (EPOLLOUT | EPOLLERR)) && channel.writing) {
+      this->Write(fd, &channel);
+    }
+    if ((flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !channel.closed) {
+      if (channel.watched) {
+        channel.readable = true;
+        found = true;
+      } else {
+        this->ReadAhead(fd, &channel);
+      }
+    }
+  }
+  return found;
+}
+
+void Transport::Write(int fd, Channel* channel) {
+  while (!channel->out.empty()) {
+    Chunk& chunk = channel->out.front();
+    ssize_t status = send(fd, chunk.data.get() + chunk.start,
+                          chunk.end - chunk.start, MSG_NOSIGNAL);
+    if (WouldBlock(status)) {
+      return;
+    }
+    chunk.start += status;
+    channel->queued -= status;
+    if (chunk.start == chunk.end) {
+      this->FreeChunk(&chunk);
+      channel->out.pop_front();
+    }
+  }
+  channel->writing = false;
+  this->Update(fd, *channel);
+}
+
+void Transport::ReadAhead(int fd, Channel* channel) {
+  if (channel->in.empty() || channel->in.back().end == TRANSPORT_CHUNK) {
+    channel->in.push_back(this->NewChunk());
+  }
+  Chunk& chunk = channel->in.back();
+  ssize_t status = read(fd, chunk.data.get() + chunk.end,
+                        TRANSPORT_CHUNK - chunk.end);
+  if (!WouldBlock(status)) {
+    chunk.end += status;
+    if (status == 0) {
+      channel->closed = true;
+      this->Update(fd, *channel);
+    }
+  }
+  if (chunk.start == chunk.end) {
+    this->FreeChunk(&chunk);
+    channel->in.pop_back();
+  }
+}
+
+bool Transport::Reap(int fd, Channel* channel) {
+  bool reaped = false;
+  while (true) {
+    char control[128];
+    msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(fd, &msg, MSG_ERRQUEUE) < 0) {
+      return reaped;  // No more completions.
+    }
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+      if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+          (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+        sock_extended_err err;
+        memcpy(&err, CMSG_DATA(cm), sizeof(err));
+        if (err.ee_errno == 0 && err.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+          // Sends [ee_info, ee_data] are complete.
+          channel->zerocopy_done += err.ee_data - err.ee_info + 1;
+          reaped = true;
+        }
+      }
+    }
+  }
+}
+
+void Transport::WaitZeroCopy(Channel* channel) {
+  while (channel->zerocopy_done != channel->zerocopy_sent) {
+    // A closed socket is not watched anymore, its completions would never
+    // be handled.
+    if (channel->closed) {
+      fprintf(stderr, "socket error: connection closed\n");
+      assert(false);
+    }
+    this->Wait(-1);
+  }
+}
+
+bool Transport::EnableZeroCopy(int fd, Channel* channel) {
+  if (channel->zerocopy == 0) {
+    int y = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &y, sizeof(y)) == 0) {
+      channel->zerocopy = 1;
+    } else {
+      channel->zerocopy = -1;
+      std::cout << "Warning: MSG_ZEROCOPY is not supported, sending with "
+                << "copies instead." << std::endl;
+    }
+  }
+  return channel->zerocopy > 0;
+}
+
+void Transport::Update(int fd, const Channel& channel) {
+  epoll_event event;
+  event.events = (channel.closed ? 0 : static_cast<uint32_t>(EPOLLIN));
+  event.events |= (channel.writing ? static_cast<uint32_t>(EPOLLOUT) : 0);
+  event.data.fd = fd;
+  if (event.events == 0) {
+    epoll_ctl(this->epfd_, EPOLL_CTL_DEL, fd, nullptr);
+  } else if (epoll_ctl(this->epfd_, EPOLL_CTL_MOD, fd, &event) < 0) {
+    if (errno != ENOENT ||
+        epoll_ctl(this->epfd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      perror("epoll error: ");
+      assert(false);
+    }
+  }
+}
+
+// Chunks.
+Transport::Chunk Transport::NewChunk() {
+  Chunk chunk = {nullptr, 0, 0};
+  if (this->spare_.empty()) {
+    chunk.data = std::unique_ptr<char[]>(new char[TRANSPORT_CHUNK]);
+  } else {
+    chunk.data = std::move(this->spare_.back());
+    this->spare_.pop_back();
+  }
+  return chunk;
+}
+
+void Transport::FreeChunk(Chunk* chunk) {
+  if (this->spare_.size() < MAX_QUEUED / TRANSPORT_CHUNK) {
+    this->spare_.push_back(std::move(chunk->data));
+  }
+}
+
+}  // namespace sockets
+}  // namespace DPPIR
@@ -0,0 +1,126 @@
+#ifndef DPPIR_SOCKETS_TRANSPORT_H_
+#define DPPIR_SOCKETS_TRANSPORT_H_
+
+#include <poll.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "DPPIR/sockets/consts.h"
+
+namespace DPPIR {
+namespace sockets {
+
+// Event loop (on top of epoll) over the non-blocking sockets of a process.
+// Sends are queued and written whenever their socket becomes writable, so a
+// send only waits if more than MAX_QUEUED bytes are queued for its socket.
+// Whenever the transport waits (for a read, a flush or queue space), it writes
+// what is queued for any socket, and reads ahead what arrives on any socket,
+// so that a peer sending to us while we are sending to it is never stalled.
+// Reading ahead is not bounded (bounding it could stall two peers that send
+// each other a batch before reading): in the worst case, a whole batch sent by
+// a peer before we read it is buffered here. MAX_QUEUED only bounds sends.
+// Not thread safe: all sockets of a transport are used by one thread at a
+// time.
+class Transport {
+ public:
+  Transport();
+  ~Transport();
+
+  // Make fd non-blocking and handle it in this event loop.
+  void Add(int fd);
+
+  // Let SendDirect() use MSG_ZEROCOPY where the kernel supports it.
+  void SetZeroCopy(bool zerocopy) { this->zerocopy_ = zerocopy; }
+
+  // Queue size-many bytes in buf to be sent via fd.
+  void Send(int fd, const char* buf, size_t size);
+  // Wait until everything queued for fd (resp. any socket) is sent.
+  void Flush(int fd);
+  void Flush();
+
+  // Send the count regions in iov via fd (after what is queued for it) from
+  // their memory, without copying them into the queue.
+  // Returns when the memory can be reused.
+  void SendDirect(int fd, const iovec* iov, size_t count);
+
+  // Read on socket specified by fd, and put results in buf.
+  void Read(int fd, char* buf, size_t buf_size);        // Read exactly buf_size.
+  size_t ReadSome(int fd, char* buf, size_t buf_size);  // Up to buf_size.
+
+  // Poll many fds (like poll(), negative fds are ignored) for reading, either
+  // blocking (timeout -1) or non-blocking (timeout 0).
+  size_t Poll(pollfd* pollfds, size_t count, int timeout, bool* result);
+
+  // Read LogicalBuffer.
+  // Read up to min(read_count, buffer capacity).
+  template <typename LOGICAL_BUFFER>
+  void Read(int fd, unsigned read_count, LOGICAL_BUFFER* buf) {
+    size_t cap = buf->BufferCapacity();
+    size_t count = read_count * buf->UnitSize() - buf->Leftover();
+    size_t b = this->ReadSome(fd, buf->ToBuffer(), count < cap ? count : cap);
+    buf->Update(b);
+  }
+
+  // Send LogicalBuffer.
+  template <typename LOGICAL_BUFFER>
+  void Send(int fd, LOGICAL_BUFFER* buf) {
+    this->Send(fd, buf->ToBuffer(), buf->BufferSize());
+  }
+
+ private:
+  // Bytes [start, end) of a TRANSPORT_CHUNK sized buffer.
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t start;
+    size_t end;
+  };
+
+  struct Channel {
+    std::deque<Chunk> out;  // Queued to be sent.
+    std::deque<Chunk> in;   // Read ahead.
+    size_t queued;          // Bytes in out.
+    bool writing;           // Waiting for the socket to become writable.
+    bool watched;           // Someone waits to read it, do not read ahead.
+    bool readable;          // Has data in its socket (if watched).
+    bool closed;            // Peer closed the connection.
+    // MSG_ZEROCOPY: 1 if enabled on the socket, -1 if not supported, 0 if
+    // not tried yet.
+    int zerocopy;
+    uint32_t zerocopy_sent;  // Zero copy sends so far.
+    uint32_t zerocopy_done;  // Of which the kernel released the memory.
+  };
+
+  // Wait for events for up to timeout ms and handle them: write queued data
+  // and read ahead from sockets that are not watched.
+  // Returns whether a watched socket became readable.
+  bool Wait(int timeout);
+  void Write(int fd, Channel* channel);
+  void ReadAhead(int fd, Channel* channel);
+  // Handle completions of zero copy sends, returns whether there were any.
+  bool Reap(int fd, Channel* channel);
+  // Wait until the memory of all zero copy sends via channel is released.
+  void WaitZeroCopy(Channel* channel);
+  bool EnableZeroCopy(int fd, Channel* channel);
+  // Update the events fd is registered for.
+  void Update(int fd, const Channel& channel);
+
+  Chunk NewChunk();
+  void FreeChunk(Chunk* chunk);
+
+  int epfd_;
+  bool zerocopy_;
+  std::unordered_map<int, Channel> channels_;
+  // Free chunks, for reuse.
+  std::vector<std::unique_ptr<char[]>> spare_;
+};
+
+}  // namespace sockets
+}  // namespace DPPIR
+
+#endif  // DPPIR_SOCKETS_TRANSPORT_H_
@@ -54,6 +54,29 @@ class ServersMap {
   std::unique_ptr<T[]> data_;
 };
 
+// Non-owning view of size contiguous elements (std::span is C++20).
+template <typename T>
+class Span {
+ public:
+  Span() : data_(nullptr), size_(0) {}
+  Span(T* data, size_t size) : data_(data), size_(size) {}
+
+  inline T& operator[](size_t i) const {
+    assert(i < this->size_);
+    return this->data_[i];
+  }
+  inline T* data() const { return this->data_; }
+  inline size_t size() const { return this->size_; }
+
+  // Iterator API.
+  inline T* begin() const { return this->data_; }
+  inline T* end() const { return this->data_ + this->size_; }
+
+ private:
+  T* data_;
+  size_t size_;
+};
+
 // Buffer with compile-time capacity SZ along with a read/write index.
 template <std::size_t SZ>
 using PhysicalBuffer = std::array<char, SZ>;
@@ -277,6 +300,7 @@ class CipherBatch {
   explicit CipherBatch(size_t short_cipher_size, size_t long_cipher_size)
       : ptr_(nullptr),
         last_short_ptr_(nullptr),
+        long_ptr_(nullptr),
         first_long_ptr_(nullptr),
         last_long_ptr_(nullptr),
         end_(nullptr),
@@ -289,6 +313,7 @@ class CipherBatch {
     size_t long_bytes = long_cipher_count * this->long_cipher_size_;
     this->ptr_ = std::make_unique<char[]>(short_bytes + long_bytes);
     this->last_short_ptr_ = this->ptr_.get();
+    this->long_ptr_ = this->ptr_.get() + short_bytes;
     this->first_long_ptr_ = this->ptr_.get() + short_bytes;
     this->last_long_ptr_ = this->ptr_.get() + short_bytes;
     this->end_ = this->ptr_.get() + short_bytes + long_bytes;
@@ -296,6 +321,7 @@ class CipherBatch {
   void Free() {
     this->ptr_ = nullptr;
     this->last_short_ptr_ = nullptr;
+    this->long_ptr_ = nullptr;
     this->first_long_ptr_ = nullptr;
     this->last_long_ptr_ = nullptr;
     this->end_ = nullptr;
@@ -329,6 +355,53 @@ class CipherBatch {
     memcpy(target, v, this->short_cipher_size_);
   }
 
+  // Processing many long ciphers concurrently.
+  // The short output of a long cipher may overlap later long ciphers, so we
+  // can only process as many ciphers at once as there are short slots freed
+  // up by previously processed ciphers (at least one).
+  inline index_t LongCount() const {
+    return (this->last_long_ptr_ - this->first_long_ptr_) /
+           this->long_cipher_size_;
+  }
+  inline index_t SafeLongCount() const {
+    index_t count = this->LongCount();
+    index_t safe = (this->first_long_ptr_ - this->last_short_ptr_) /
+                   this->short_cipher_size_;
+    if (safe == 0) {
+      safe = 1;
+    }
+    return count < safe ? count : safe;
+  }
+  // idx is relative to the first unprocessed long cipher.
+  inline char* GetLong(index_t idx) {
+    return this->first_long_ptr_ + (idx * this->long_cipher_size_);
+  }
+  // idx is relative to the first unused short slot.
+  inline char* GetNextShort(index_t idx) {
+    return this->last_short_ptr_ + (idx * this->short_cipher_size_);
+  }
+  // Marks count short slots filled via GetNextShort() as pushed.
+  inline void AdvanceShort(index_t count) {
+    this->last_short_ptr_ += count * this->short_cipher_size_;
+  }
+  // Equivalent to count calls to PopLong() and PushShort() after the short
+  // outputs have been written via GetNextShort().
+  inline void AdvanceLong(index_t count) {
+    this->first_long_ptr_ += count * this->long_cipher_size_;
+    this->last_short_ptr_ += count * this->short_cipher_size_;
+  }
+
+  // Receiving long ciphers concurrently with processing them: the receiving
+  // thread writes the idx-th long cipher directly to LongSlot(idx), and the
+  // processing thread then marks the first count as pushed with
+  // SetLongCount(count). Slots past count are never touched by processing.
+  inline char* LongSlot(index_t idx) {
+    return this->long_ptr_ + (idx * this->long_cipher_size_);
+  }
+  inline void SetLongCount(index_t count) {
+    this->last_long_ptr_ = this->long_ptr_ + (count * this->long_cipher_size_);
+  }
+
   // Iterator API.
   inline CipherIterator begin() {
     return CipherIterator(this->ptr_.get(), this->short_cipher_size_);
@@ -344,6 +417,7 @@ class CipherBatch {
  private:
   std::unique_ptr<char[]> ptr_;
   char* last_short_ptr_;
+  char* long_ptr_;  // Start of the long region.
   char* first_long_ptr_;
   char* last_long_ptr_;
   char* end_;
@@ -2,7 +2,9 @@
 #include "DPPIR/types/state.h"
 
 #include <cassert>
-#include <utility>
+#include <cstring>
+
+#include "DPPIR/sharing/additive.h"
 
 namespace DPPIR {
 
@@ -16,13 +18,13 @@ namespace DPPIR {
 void ClientState::Initialize(party_id_t party_count, index_t secrets,
                              bool noise, bool simulated) {
   this->simulated_ = simulated;
-  this->write_idx_ = 0;
+  this->party_count_ = party_count;
   this->read_idx_ = 0;
   this->size_ = simulated ? 1 : secrets;
   // Allocate memory.
   this->tags_ = std::make_unique<tag_t[]>(this->size_);
-  this->incrementals_ =
-      std::make_unique<std::vector<incremental_share_t>[]>(this->size_);
+  this->incrementals_ = std::make_unique<incremental_inverse_t[]>(
+      static_cast<size_t>(this->size_) * party_count);
   if (!noise) {
     this->preshares_ = std::make_unique<preshare_t[]>(this->size_);
   }
@@ -30,7 +32,7 @@ void ClientState::Initialize(party_id_t party_count, index_t secrets,
   if (this->simulated_) {
     this->tags_[0] = 0;
     for (party_id_t i = 0; i < party_count; i++) {
-      this->incrementals_[0].push_back({0, 1});
+      this->incrementals_[i] = {0, 1};
     }
     if (!noise) {
       this->preshares_[0].fill(0);
@@ -39,19 +41,20 @@ void ClientState::Initialize(party_id_t party_count, index_t secrets,
 }
 
 // Storing secrets (offline).
-void ClientState::AddNoiseSecret(
-    const tag_t& tag, std::vector<incremental_share_t>&& incrementals) {
-  this->tags_[this->write_idx_] = tag;
-  this->incrementals_[this->write_idx_] = std::move(incrementals);
-  this->write_idx_++;
-}
-void ClientState::AddSecret(const tag_t& tag,
-                            std::vector<incremental_share_t>&& incrementals,
+Span<incremental_inverse_t> ClientState::IncrementalSlot(index_t idx) {
+  assert(idx < this->size_);
+  size_t offset = static_cast<size_t>(idx) * this->party_count_;
+  return {this->incrementals_.get() + offset, this->party_count_};
+}
+void ClientState::AddNoiseSecret(index_t idx, const tag_t& tag) {
+  assert(idx < this->size_);
+  this->tags_[idx] = tag;
+}
+void ClientState::AddSecret(index_t idx, const tag_t& tag,
                             const preshare_t& preshare) {
-  this->tags_[this->write_idx_] = tag;
-  this->incrementals_[this->write_idx_] = std::move(incrementals);
-  this->preshares_[this->write_idx_] = preshare;
-  this->write_idx_++;
+  assert(idx < this->size_);
+  this->tags_[idx] = tag;
+  this->preshares_[idx] = preshare;
 }
 
 // Get a new secret from the stored secrets.
@@ -62,11 +65,12 @@ const tag_t& ClientState::GetTag() {
   }
   return this->tags_[this->read_idx_ - 1];
 }
-const std::vector<incremental_share_t>& ClientState::GetIncrementalShares() {
-  if (this->simulated_) {
-    return this->incrementals_[0];
+Span<const incremental_inverse_t> ClientState::GetIncrementalShares() {
+  size_t offset = 0;
+  if (!this->simulated_) {
+    offset = static_cast<size_t>(this->read_idx_ - 1) * this->party_count_;
   }
-  return this->incrementals_[this->read_idx_ - 1];
+  return {this->incrementals_.get() + offset, this->party_count_};
 }
 const preshare_t& ClientState::GetPreshare() {
   if (this->simulated_) {
@@ -83,7 +87,6 @@ void ClientState::FinishSharing() {
 }
 
 void ClientState::Free() {
-  this->write_idx_ = 0;
   this->read_idx_ = 0;
   this->size_ = 0;
   this->tags_ = nullptr;
@@ -91,6 +94,38 @@ void ClientState::Free() {
   this->preshares_ = nullptr;
 }
 
+// PresharePool.
+void PresharePool::Initialize(bool seeded) { this->seeded_ = seeded; }
+
+index_t PresharePool::Add(const OfflineSecret& secret) {
+  if (this->seeded_) {
+    this->seeds_.emplace_back();
+    memcpy(this->seeds_.back().data(), secret.preshare.data(),
+           PRESHARE_SEED_T_SIZE);
+    return this->seeds_.size() - 1;
+  }
+  this->preshares_.push_back(secret.preshare);
+  return this->preshares_.size() - 1;
+}
+
+preshare_t PresharePool::Get(index_t idx) const {
+  if (this->seeded_) {
+    preshare_t preshare;
+    sharing::ExpandAdditiveSeed(this->seeds_.at(idx), &preshare);
+    return preshare;
+  }
+  return this->preshares_.at(idx);
+}
+
+void PresharePool::Export(index_t idx, OfflineSecret* secret) const {
+  if (this->seeded_) {
+    memcpy(secret->preshare.data(), this->seeds_.at(idx).data(),
+           PRESHARE_SEED_T_SIZE);
+  } else {
+    secret->preshare = this->preshares_.at(idx);
+  }
+}
+
 // PartyState.
 // Simulated -> we are running the online stage alone with no offline stage.
 // For the sake of speeding up experimentation.
@@ -98,21 +133,23 @@ void ClientState::Free() {
 // identity shares/tags.
 // Otherwise, the state is actually created during the offline stage and
 // used online.
-void PartyState::Initialize(bool simulated) {
+void PartyState::Initialize(bool simulated, bool seeded) {
   this->simulated_ = simulated;
+  this->preshares_.Initialize(seeded);
   if (this->simulated_) {
     secret& st = this->secrets_[0];
     st.next_tag = 0;
     st.incremental = {0, 1};
-    st.preshare.fill(0);
+    st.preshare = 0;
   }
 }
 
 // Store secret.
 void PartyState::Store(const OfflineSecret& secret) {
+  index_t preshare = this->preshares_.Add(secret);
   auto [_, b] = this->secrets_.emplace(
       std::piecewise_construct, std::forward_as_tuple(secret.tag),
-      std::forward_as_tuple(secret.next_tag, secret.share, secret.preshare));
+      std::forward_as_tuple(secret.next_tag, secret.share, preshare));
   // Ensures no colisions.
   assert(b);
 }
@@ -129,14 +166,20 @@ const tag_t& PartyState::GetNextTag() { return this->it_->second.next_tag; }
 const incremental_share_t& PartyState::GetIncremental() {
   return this->it_->second.incremental;
 }
-const preshare_t& PartyState::GetPreshare(const tag_t& tag) {
+preshare_t PartyState::GetPreshare(const tag_t& tag) {
   if (this->simulated_) {
-    return this->secrets_.at(0).preshare;
+    return preshare_t{};  // 0-initialized.
   } else {
-    return this->secrets_.at(tag).preshare;
+    return this->preshares_.Get(this->secrets_.at(tag).preshare);
   }
 }
 
+OfflineSecret PartyState::Export(const const_iterator::value_type& e) const {
+  OfflineSecret secret = {e.first, e.second.next_tag, e.second.incremental, {}};
+  this->preshares_.Export(e.second.preshare, &secret);
+  return secret;
+}
+
 // BackendState.
 // Simulated -> we are running the online stage alone with no offline stage.
 // For the sake of speeding up experimentation.
@@ -144,20 +187,22 @@ const preshare_t& PartyState::GetPreshare(const tag_t& tag) {
 // identity shares/tags.
 // Otherwise, the state is actually created during the offline stage and
 // used online.
-void BackendState::Initialize(bool simulated) {
+void BackendState::Initialize(bool simulated, bool seeded) {
   this->simulated_ = simulated;
+  this->preshares_.Initialize(seeded);
   if (this->simulated_) {
     secret& st = this->secrets_[0];
     st.incremental = {0, 1};
-    st.preshare.fill(0);
+    st.preshare = 0;
   }
 }
 
 // Store secret.
 void BackendState::Store(const OfflineSecret& secret) {
+  index_t preshare = this->preshares_.Add(secret);
   auto [_, b] = this->secrets_.emplace(
       std::piecewise_construct, std::forward_as_tuple(secret.tag),
-      std::forward_as_tuple(secret.share, secret.preshare));
+      std::forward_as_tuple(secret.share, preshare));
   // Ensures no colisions.
   assert(b);
 }
@@ -173,8 +218,17 @@ void BackendState::LoadSecret(const tag_t& tag) {
 const incremental_share_t& BackendState::GetIncremental() {
   return this->it_->second.incremental;
 }
-const preshare_t& BackendState::GetPreshare() {
-  return this->it_->second.preshare;
+preshare_t BackendState::GetPreshare() {
+  if (this->simulated_) {
+    return preshare_t{};  // 0-initialized.
+  }
+  return this->preshares_.Get(this->it_->second.preshare);
+}
+
+OfflineSecret BackendState::Export(const const_iterator::value_type& e) const {
+  OfflineSecret secret = {e.first, 0, e.second.incremental, {}};
+  this->preshares_.Export(e.second.preshare, &secret);
+  return secret;
 }
 
 }  // namespace DPPIR
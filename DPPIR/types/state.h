@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "DPPIR/types/containers.h"
 #include "DPPIR/types/types.h"
 
 namespace DPPIR {
@@ -23,16 +24,18 @@ class ClientState {
                   bool simulated);
 
   // Storing secrets (offline).
-  void AddNoiseSecret(const tag_t& tag,
-                      std::vector<incremental_share_t>&& incrementals);
-  void AddSecret(const tag_t& tag,
-                 std::vector<incremental_share_t>&& incrementals,
-                 const preshare_t& preshare);
+  // Secrets are written at an explicit index so that different threads can
+  // fill disjoint ranges of the state concurrently.
+  // The party_count incremental shares of secret idx are written in place to
+  // IncrementalSlot(idx), inverted (see InvertIncrementalShares()).
+  Span<incremental_inverse_t> IncrementalSlot(index_t idx);
+  void AddNoiseSecret(index_t idx, const tag_t& tag);
+  void AddSecret(index_t idx, const tag_t& tag, const preshare_t& preshare);
 
   // Get a new secret from the stored secrets.
   void LoadNext();
   const tag_t& GetTag();
-  const std::vector<incremental_share_t>& GetIncrementalShares();
+  Span<const incremental_inverse_t> GetIncrementalShares();
   const preshare_t& GetPreshare();
 
   // Free memory when sharing is done (retain preshares for responses).
@@ -41,26 +44,46 @@ class ClientState {
 
  private:
   bool simulated_;
+  party_id_t party_count_;
   // Indices.
-  index_t write_idx_;
   index_t read_idx_;
   index_t size_;
   // Memory.
   std::unique_ptr<tag_t[]> tags_;
-  std::unique_ptr<std::vector<incremental_share_t>[]> incrementals_;
+  // Flat size_ x party_count_ array, secret i owns
+  // [i * party_count_, (i + 1) * party_count_).
+  std::unique_ptr<incremental_inverse_t[]> incrementals_;
   std::unique_ptr<preshare_t[]> preshares_;
 };
 
+// Preshares of installed secrets, stored either as is or as seeds.
+class PresharePool {
+ public:
+  void Initialize(bool seeded);
+
+  // Store the preshare (or seed) of secret, returns its index.
+  index_t Add(const OfflineSecret& secret);
+  // The (expanded) preshare at index.
+  preshare_t Get(index_t idx) const;
+  // Put the preshare (or seed) back in secret, e.g. to send it to siblings.
+  void Export(index_t idx, OfflineSecret* secret) const;
+
+ private:
+  bool seeded_;
+  std::vector<preshare_t> preshares_;
+  std::vector<preshare_seed_t> seeds_;
+};
+
 class PartyState {
  public:
   // Stored secret.
   struct secret {
     tag_t next_tag;
     incremental_share_t incremental;
-    preshare_t preshare;
+    index_t preshare;  // Index in preshares_.
     // Constructor for emplace.
     secret() = default;
-    secret(const tag_t& n, const incremental_share_t& i, const preshare_t& p)
+    secret(const tag_t& n, const incremental_share_t& i, index_t p)
         : next_tag(n), incremental(i), preshare(p) {}
   };
 
@@ -71,7 +94,8 @@ class PartyState {
   // identity shares/tags.
   // Otherwise, the state is actually created during the offline stage and
   // used online.
-  void Initialize(bool simulated);
+  // Seeded -> preshares are received as seeds and expanded when used.
+  void Initialize(bool simulated, bool seeded);
 
   // Store secret.
   void Store(const OfflineSecret& secret);
@@ -80,18 +104,21 @@ class PartyState {
   void LoadSecret(const tag_t& tag);
   const tag_t& GetNextTag();
   const incremental_share_t& GetIncremental();
-  const preshare_t& GetPreshare(const tag_t& tag);
+  preshare_t GetPreshare(const tag_t& tag);
 
   // Iteration over all installed secrets.
   using const_iterator = std::unordered_map<tag_t, secret>::const_iterator;
   const_iterator begin() const { return this->secrets_.begin(); }
   const_iterator end() const { return this->secrets_.end(); }
   index_t size() const { return this->secrets_.size(); }
+  // Turn an installed secret back into an OfflineSecret.
+  OfflineSecret Export(const const_iterator::value_type& entry) const;
 
  private:
   bool simulated_;
   // storage.
   std::unordered_map<tag_t, secret> secrets_;
+  PresharePool preshares_;
   // cache iterator when LoadSecret() is called for following calls to
   // GetNextTag() and GetIncremental().
   const_iterator it_;
@@ -103,10 +130,10 @@ class BackendState {
   // Stored secret.
   struct secret {
     incremental_share_t incremental;
-    preshare_t preshare;
+    index_t preshare;  // Index in preshares_.
     // Constructor for emplace.
     secret() = default;
-    secret(const incremental_share_t& i, const preshare_t& p)
+    secret(const incremental_share_t& i, index_t p)
         : incremental(i), preshare(p) {}
   };
 
@@ -117,7 +144,8 @@ class BackendState {
   // identity shares/tags.
   // Otherwise, the state is actually created during the offline stage and
   // used online.
-  void Initialize(bool simulated);
+  // Seeded -> preshares are received as seeds and expanded when used.
+  void Initialize(bool simulated, bool seeded);
 
   // Store secret.
   void Store(const OfflineSecret& secret);
@@ -125,18 +153,21 @@ class BackendState {
   // Lookup offline secrets by tag.
   void LoadSecret(const tag_t& tag);
   const incremental_share_t& GetIncremental();
-  const preshare_t& GetPreshare();
+  preshare_t GetPreshare();
 
   // Iteration over all installed secrets.
   using const_iterator = std::unordered_map<tag_t, secret>::const_iterator;
   const_iterator begin() const { return this->secrets_.begin(); }
   const_iterator end() const { return this->secrets_.end(); }
   index_t size() const { return this->secrets_.size(); }
+  // Turn an installed secret back into an OfflineSecret (with no next tag).
+  OfflineSecret Export(const const_iterator::value_type& entry) const;
 
  private:
   bool simulated_;
   // storage.
   std::unordered_map<tag_t, secret> secrets_;
+  PresharePool preshares_;
   // cache iterator when LoadSecret() is called for following calls to
   // GetIncremental() and GetPreshare().
   const_iterator it_;
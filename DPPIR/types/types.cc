@@ -1,7 +1,36 @@
 #include "DPPIR/types/types.h"
 
+#include <cassert>
+
 namespace DPPIR {
 
+// Server i gets [total * W(< i) / W, total * W(<= i) / W), where W(< i) is the
+// sum of the weights of the servers before i.
+std::pair<index_t, index_t> WeightedRange(server_id_t server_id,
+                                          server_id_t server_count,
+                                          const std::vector<index_t>& weights,
+                                          index_t total) {
+  assert(server_id < server_count);
+  assert(weights.empty() || weights.size() == server_count);
+  uint64_t before = server_id;
+  uint64_t sum = server_count;
+  if (!weights.empty()) {
+    before = 0;
+    sum = 0;
+    for (server_id_t id = 0; id < server_count; id++) {
+      assert(weights[id] > 0 && weights[id] <= MAX_SERVER_WEIGHT);
+      if (id < server_id) {
+        before += weights[id];
+      }
+      sum += weights[id];
+    }
+  }
+  uint64_t own = weights.empty() ? 1 : weights[server_id];
+  index_t start = total * before / sum;
+  index_t end = total * (before + own) / sum;
+  return std::make_pair(start, end);
+}
+
 // Debugging/Printing.
 std::ostream& operator<<(std::ostream& o, const Query& q) {
   return o << "{tag: " << q.tag << ", tally: " << q.tally << "}";
@@ -7,12 +7,15 @@
 #include <memory>
 #include <ostream>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 // NOLINTNEXTLINE
 #include "sodium.h"
 
 #define SIG_T_SIZE 48  // 48 bytes.
 #define PRESHARE_T_SIZE (4 + SIG_T_SIZE)
+#define PRESHARE_SEED_T_SIZE 16  // 128 bits.
 #define INCREMENTAL_PRIME 2147483647u  // 2^31 - 1.
 
 namespace DPPIR {
@@ -34,6 +37,26 @@ using sample_t = uint32_t;
 using pkey_t = std::array<unsigned char, crypto_box_PUBLICKEYBYTES>;
 using skey_t = std::array<unsigned char, crypto_box_SECRETKEYBYTES>;
 
+// Onion cipher formats (see DPPIR/onion). All formats have the same size.
+enum class OnionFormat : int {
+  kSealed = 0,           // Nested crypto_box_seal (default).
+  kHybridXChaCha20 = 1,  // X25519 key exchange + XChaCha20-Poly1305.
+  kHybridAesGcm = 2,     // X25519 key exchange + AES-256-GCM (needs AES-NI).
+};
+
+// How offline secrets are onion encrypted (part of the config).
+// See SEEDED_SECRET_SIZE below.
+struct OnionScheme {
+  OnionFormat format = OnionFormat::kSealed;
+  bool seeded = false;  // Send preshare seeds instead of preshares.
+};
+
+// DP noise mechanisms (see DPPIR/noise).
+enum class NoiseMechanism : int {
+  kLaplace = 0,    // Floored Laplace, clamped to [0, 2 * cutoff] (default).
+  kGeometric = 1,  // Two-sided geometric, truncated to [0, 2 * shift].
+};
+
 // Signatures.
 static_assert(sizeof(sig_t) == sizeof(char) * SIG_T_SIZE);
 
@@ -43,8 +66,14 @@ struct __attribute__((__packed__)) incremental_share_t {
   uint32_t x;
   uint32_t y;
 };
+// What the creator of a share keeps to compute tallies: y is replaced by its
+// (precomputed) inverse.
+struct incremental_inverse_t {
+  uint32_t x;
+  uint32_t y_inverse;
+};
 using incremental_tally_t = uint32_t;
-// using preshare_seed_t = int32_t;
+using preshare_seed_t = std::array<char, PRESHARE_SEED_T_SIZE>;
 using preshare_t = std::array<char, PRESHARE_T_SIZE>;
 static_assert(sizeof(preshare_t) == sizeof(char) * PRESHARE_T_SIZE);
 static_assert(PRESHARE_T_SIZE % sizeof(uint32_t) == 0);
@@ -58,6 +87,12 @@ struct __attribute__((__packed__)) OfflineSecret {
 };
 static_assert(sizeof(OfflineSecret) == 24 + PRESHARE_T_SIZE);
 
+// With seeded preshares, the preshare of an OfflineSecret starts with a seed
+// that expands to the actual preshare, and only this prefix of the struct is
+// onion encrypted.
+#define SEEDED_SECRET_SIZE (24 + PRESHARE_SEED_T_SIZE)
+static_assert(PRESHARE_SEED_T_SIZE <= PRESHARE_T_SIZE);
+
 // Online query.
 struct __attribute__((__packed__)) Query {
   tag_t tag;
@@ -74,6 +109,18 @@ static_assert(sizeof(Response) == SIG_T_SIZE + 4);
 static_assert(sizeof(Response) == PRESHARE_T_SIZE);
 static_assert(sizeof(Response) == sizeof(preshare_t));
 
+// Largest server weight, so that total times the sum of weights (of at most
+// 255 servers) fits in 64 bits.
+#define MAX_SERVER_WEIGHT 65536  // 2^16.
+
+// Splits [0, total) into consecutive ranges, one per server, with sizes
+// proportional to the weights of servers (equal sizes if weights is empty).
+// Returns the range of server_id.
+std::pair<index_t, index_t> WeightedRange(server_id_t server_id,
+                                          server_id_t server_count,
+                                          const std::vector<index_t>& weights,
+                                          index_t total);
+
 // Debugging/Printing.
 std::ostream& operator<<(std::ostream& o, const Query& q);
 std::ostream& operator<<(std::ostream& o, const Response& r);